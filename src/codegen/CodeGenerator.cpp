@@ -1,109 +1,827 @@
 #include "CodeGenerator.hpp"
+#include "Runtime.hpp"
 #include <sstream>
+#include <algorithm>
 
-CodeGenerator::CodeGenerator() : labelCount(0) {
-    dataSection = ".DATA\n";
-    codeSection = ".CODE\n";
+namespace {
+
+bool callsFunction(const ASTNode& expression) {
+    std::vector<const ASTNode*> pending { &expression };
+    while (!pending.empty()) {
+        const ASTNode* node = pending.back();
+        pending.pop_back();
+        if (node->kind == NodeKind::FunctionCall) return true;
+        for (const auto& child : node->children) {
+            pending.push_back(child.get());
+        }
+    }
+    return false;
+}
+
+// Decimal text of an int literal, if it is one that fits in a word.
+bool literalText(const ASTNode& node, std::string& text) {
+    if (node.kind != NodeKind::Number || node.value.find('.') != std::string::npos) return false;
+    if (node.value.size() > 5 || std::stol(node.value) > 32767) return false;
+    text = std::to_string(std::stol(node.value));
+    return true;
 }
 
+// Most characters the runtime writes for a value of the type; a string's
+// length is only known at run time.
+size_t maxTextLength(TypeId type) {
+    switch (type) {
+    case Types::String:
+        return 0;
+    case Types::Char:
+        return 1;
+    case Types::Float:
+        return 10; // "-" and the integer part, a point and two decimals
+    default:
+        return 6;  // "-32768"
+    }
+}
+
+}
+
+CodeGenerator::CodeGenerator(bool reportFrames)
+    : labelCount(0), frameAllocator(types), reportFrames(reportFrames) {}
+
 std::string CodeGenerator::newLabel() {
     return "L" + std::to_string(labelCount++);
 }
 
-void CodeGenerator::generateNode(const std::shared_ptr<ASTNode>& node) {
-    if (node->nodeType == "Program" || node->nodeType == "Block") {
-        for (const auto& child : node->children) {
-            generateNode(child);
+// Declared type of a variable-like node; the analyzer's annotation wins when
+// it ran, so the generator also works on an unchecked tree.
+TypeId CodeGenerator::typeOf(const ASTNode& node) const {
+    if (node.type != Types::Unknown) return node.type;
+    return types.lookup(node.typeName);
+}
+
+void CodeGenerator::declareData(const std::string& name, TypeId type, const std::string& initial) {
+    dataEntries.push_back({ name, type, initial });
+}
+
+// Lays out the pending data entries widest alignment first, so no padding is
+// needed between them; ALIGN is only emitted when an earlier flush left the
+// offset unaligned.
+std::string CodeGenerator::flushData() {
+    std::stable_sort(dataEntries.begin(), dataEntries.end(), [this](const DataEntry& a, const DataEntry& b) {
+        return types.alignOf(a.type) > types.alignOf(b.type);
+    });
+
+    std::string text;
+    for (const auto& entry : dataEntries) {
+        size_t size = types.sizeOf(entry.type);
+        size_t align = types.alignOf(entry.type);
+        if (dataOffset % align != 0) {
+            text += "ALIGN " + std::to_string(align) + "\n";
+            dataOffset += align - dataOffset % align;
         }
+
+        const char* directive = size == 1 ? " DB " : size == 4 ? " DD " : " DW ";
+        text += entry.name + directive + entry.initial + "\n";
+        dataOffset += size;
     }
-    else if (node->nodeType == "Declaration") {
-        auto pos = node->value.find(':');
-        std::string varName = node->value.substr(0, pos);
-        std::string varType = node->value.substr(pos + 1);
+    dataEntries.clear();
+    return text;
+}
+
+std::string CodeGenerator::floatConstant(const std::string& literal) {
+    auto it = floatConstants.find(literal);
+    if (it != floatConstants.end()) return it->second;
+
+    std::string name = "F" + std::to_string(floatConstants.size());
+    std::string initial = literal.find('.') == std::string::npos ? literal + ".0" : literal;
+    declareData(name, Types::Float, initial);
+    floatConstants.emplace(literal, name);
+    return name;
+}
+
+// Literals and variables the FPU can read straight from memory: floats as
+// they are, ints through the FI* instructions (`integer`).
+bool CodeGenerator::floatOperand(const ASTNode& value, std::string& text, bool& integer) {
+    if (value.kind == NodeKind::Number) {
+        text = floatConstant(value.value);
+        integer = false;
+        return true;
+    }
+    if (value.kind != NodeKind::Variable) return false;
+
+    TypeId type = typeOf(value);
+    if (type != Types::Float && types.sizeOf(type) != 2) return false;
+    text = operand(value);
+    integer = type != Types::Float;
+    return true;
+}
+
+// Evaluates a numeric expression into ST(0); int parts are converted on load.
+// A right operand that is not a literal or variable is computed while the
+// left one waits in a stack slot, so the FPU stack never holds more than two
+// values, however deep the expression.
+void CodeGenerator::loadFloat(const ASTNode& expression) {
+    enum class Action { Evaluate, Save, Combine, Apply };
+    struct Step {
+        const ASTNode* node;
+        Action action;
+    };
+    // Instruction for `ST(0) op operand`, and for `saved op ST(0)`.
+    static const std::unordered_map<std::string, std::pair<std::string, std::string>> arithmetic = {
+        { "+", { "ADD", "ADD" } }, { "-", { "SUB", "SUBR" } },
+        { "*", { "MUL", "MUL" } }, { "/", { "DIV", "DIVR" } },
+    };
+    std::vector<Step> pending { { &expression, Action::Evaluate } };
 
-        dataSection += varName + " DW 0\n";
+    while (!pending.empty()) {
+        Step step = pending.back();
+        pending.pop_back();
+        const ASTNode& node = *step.node;
+        std::string text;
+        bool integer = false;
 
-        if (!node->children.empty()) {
-            codeSection += "MOV " + varName + ", ";
-            codeSection += node->children[0]->value + "\n";
+        if (step.action == Action::Save) {
+            codeSection += "SUB SP, 4\n";
+            codeSection += "MOV BX, SP\n";
+            codeSection += "FSTP DWORD PTR [BX]\n";
+        } else if (step.action == Action::Combine) {
+            codeSection += "MOV BX, SP\n";
+            codeSection += "F" + arithmetic.at(node.value).second + " DWORD PTR [BX]\n";
+            codeSection += "ADD SP, 4\n";
+        } else if (step.action == Action::Apply) {
+            floatOperand(*node.children[1], text, integer);
+            codeSection += std::string(integer ? "FI" : "F") + arithmetic.at(node.value).first + " " + text + "\n";
+        } else if (node.kind == NodeKind::BinaryOp && node.children.size() == 2 && typeOf(node) == Types::Float &&
+                   arithmetic.count(node.value)) {
+            if (floatOperand(*node.children[1], text, integer)) {
+                pending.push_back({ &node, Action::Apply });
+            } else {
+                pending.push_back({ &node, Action::Combine });
+                pending.push_back({ node.children[1].get(), Action::Evaluate });
+                pending.push_back({ &node, Action::Save });
+            }
+            pending.push_back({ node.children[0].get(), Action::Evaluate });
+        } else if (floatOperand(node, text, integer)) {
+            codeSection += std::string(integer ? "FILD " : "FLD ") + text + "\n";
+        } else if (node.kind == NodeKind::FunctionCall && typeOf(node) == Types::Float) {
+            emitCall(node);
+        } else {
+            loadInt(node);
+            codeSection += "PUSH AX\n";
+            codeSection += "MOV BX, SP\n";
+            codeSection += "FILD WORD PTR [BX]\n";
+            codeSection += "ADD SP, 2\n";
         }
     }
-    else if (node->nodeType == "Param") {
-        auto pos = node->value.find(':');
-        std::string varName = node->value.substr(0, pos);
+}
+
+// Compares two numbers, at least one of them float, and leaves 0 or 1 in AX.
+// The FPU reports the result like an unsigned compare once in the flags.
+void CodeGenerator::compareFloats(const ASTNode& comparison) {
+    static const std::unordered_map<std::string, std::string> jumps = {
+        { "<", "JB" }, { ">", "JA" }, { "<=", "JBE" }, { ">=", "JAE" }, { "==", "JE" }, { "!=", "JNE" },
+    };
+    // For `right compared to saved left`.
+    static const std::unordered_map<std::string, std::string> swapped = {
+        { "<", "JA" }, { ">", "JB" }, { "<=", "JAE" }, { ">=", "JBE" }, { "==", "JE" }, { "!=", "JNE" },
+    };
 
-        dataSection += varName + " DW 0\n";
+    loadFloat(*comparison.children[0]);
+    std::string text;
+    bool integer = false;
+    std::string jump;
+    if (floatOperand(*comparison.children[1], text, integer)) {
+        codeSection += std::string(integer ? "FICOMP " : "FCOMP ") + text + "\n";
+        jump = jumps.at(comparison.value);
+    } else {
+        codeSection += "SUB SP, 4\n";
+        codeSection += "MOV BX, SP\n";
+        codeSection += "FSTP DWORD PTR [BX]\n";
+        loadFloat(*comparison.children[1]);
+        codeSection += "MOV BX, SP\n";
+        codeSection += "FCOMP DWORD PTR [BX]\n";
+        codeSection += "ADD SP, 4\n";
+        jump = swapped.at(comparison.value);
     }
-    else if (node->nodeType == "Expression") {
-        codeSection += "; Expression uses " + node->value + "\n";
+
+    std::string done = newLabel();
+    codeSection += "FSTSW AX\n";
+    codeSection += "SAHF\n";
+    codeSection += "MOV AX, 1\n";
+    codeSection += jump + " " + done + "\n";
+    codeSection += "XOR AX, AX\n";
+    codeSection += done + ":\n";
+}
+
+std::string CodeGenerator::frameOperand(int offset, TypeId type) const {
+    size_t size = types.sizeOf(type);
+    const char* width = size == 1 ? "BYTE PTR " : size == 4 ? "DWORD PTR " : "WORD PTR ";
+    return std::string(width) + "[BP" + (offset < 0 ? "" : "+") + std::to_string(offset) + "]";
+}
+
+// Variables resolve to their frame slot inside functions and to their data
+// label otherwise; other expressions are used as written. Only the scopes of
+// the innermost function are searched, since BP points at its frame.
+std::string CodeGenerator::operand(const ASTNode& value) const {
+    if (value.kind == NodeKind::Variable) {
+        size_t first = frameScopes.empty() ? 0 : frameScopes.back();
+        for (size_t scope = localScopes.size(); scope-- > first;) {
+            auto it = localScopes[scope].find(value.value);
+            if (it != localScopes[scope].end()) return it->second;
+        }
     }
-    else if (node->nodeType == "If") {
-        std::string elseLabel = newLabel();
-        std::string endLabel = newLabel();
+    return value.value;
+}
 
-        codeSection += "; IF condition\n";
-        codeSection += "CMP " + node->children[0]->value + ", 0\n";
-        codeSection += "JE " + elseLabel + "\n";
+// Operand text of a literal or variable.
+std::string CodeGenerator::valueOf(const ASTNode& value) {
+    if (value.kind == NodeKind::String) {
+        return "OFFSET " + stringConstant(value.value);
+    }
+    return operand(value);
+}
 
-        generateNode(node->children[1]);
+// Evaluates anything but a float into AX: ints, bools (0 or 1), chars
+// (zero-extended) and string addresses. The left operand of each operator
+// waits on the stack while the right one is computed. Calls leave their
+// result in AX, float ones in ST(0).
+void CodeGenerator::loadInt(const ASTNode& expression) {
+    enum class Action { Evaluate, Save, Combine };
+    struct Step {
+        const ASTNode* node;
+        Action action;
+    };
+    std::vector<Step> pending { { &expression, Action::Evaluate } };
 
-        codeSection += "JMP " + endLabel + "\n";
-        codeSection += elseLabel + ":\n";
+    while (!pending.empty()) {
+        Step step = pending.back();
+        pending.pop_back();
+        const ASTNode& node = *step.node;
 
-        if (node->children.size() > 2) {
-            generateNode(node->children[2]);
+        if (step.action == Action::Save) {
+            codeSection += "PUSH AX\n";
+        } else if (step.action == Action::Combine) {
+            codeSection += "MOV BX, AX\n";
+            codeSection += "POP AX\n";
+
+            static const std::unordered_map<std::string, std::string> arithmetic = {
+                { "+", "ADD AX, BX\n" }, { "-", "SUB AX, BX\n" },
+                { "*", "IMUL BX\n" }, { "/", "CWD\nIDIV BX\n" },
+            };
+            static const std::unordered_map<std::string, std::string> comparisons = {
+                { "<", "JL" }, { ">", "JG" }, { "<=", "JLE" }, { ">=", "JGE" }, { "==", "JE" }, { "!=", "JNE" },
+            };
+            auto op = arithmetic.find(node.value);
+            if (op != arithmetic.end()) {
+                codeSection += op->second;
+            } else {
+                auto jump = comparisons.find(node.value);
+                if (jump == comparisons.end()) continue;
+                std::string done = newLabel();
+                codeSection += "CMP AX, BX\n";
+                codeSection += "MOV AX, 1\n";
+                codeSection += jump->second + " " + done + "\n";
+                codeSection += "XOR AX, AX\n";
+                codeSection += done + ":\n";
+            }
+        } else if (node.kind == NodeKind::FunctionCall) {
+            emitCall(node);
+        } else if (node.kind == NodeKind::BinaryOp && typeOf(node) == Types::String) {
+            writeString(node, "", true);
+        } else if (node.kind == NodeKind::BinaryOp && node.children.size() == 2 &&
+                   (typeOf(*node.children[0]) == Types::Float || typeOf(*node.children[1]) == Types::Float)) {
+            compareFloats(node);
+        } else if (node.kind == NodeKind::BinaryOp && node.children.size() == 2) {
+            pending.push_back({ &node, Action::Combine });
+            pending.push_back({ node.children[1].get(), Action::Evaluate });
+            pending.push_back({ &node, Action::Save });
+            pending.push_back({ node.children[0].get(), Action::Evaluate });
+        } else if (node.kind == NodeKind::Variable && types.sizeOf(typeOf(node)) == 1) {
+            codeSection += "MOV AL, " + operand(node) + "\n";
+            codeSection += "XOR AH, AH\n";
+        } else {
+            codeSection += "MOV AX, " + valueOf(node) + "\n";
         }
+    }
+}
+
+// Pooled in the read-only section and zero-terminated, so a literal can also
+// be used as a string value.
+std::string CodeGenerator::stringConstant(const std::string& text) {
+    auto it = stringLiterals.find(text);
+    if (it != stringLiterals.end()) return it->second;
 
-        codeSection += endLabel + ":\n";
+    std::string name = "S" + std::to_string(stringLiterals.size());
+    std::string bytes;
+    bool quoted = false;
+    for (unsigned char c : text) {
+        if (c >= 32 && c != '"') {
+            if (!quoted) {
+                if (!bytes.empty()) bytes += ", ";
+                bytes += '"';
+                quoted = true;
+            }
+            bytes += static_cast<char>(c);
+        } else {
+            if (quoted) bytes += '"';
+            quoted = false;
+            if (!bytes.empty()) bytes += ", ";
+            bytes += std::to_string(c);
+        }
     }
-    else if (node->nodeType == "While") {
-        std::string startLabel = newLabel();
-        std::string endLabel = newLabel();
+    if (quoted) bytes += '"';
+    if (!bytes.empty()) bytes += ", ";
+
+    constSection += name + " DB " + bytes + "0\n";
+    stringLiterals.emplace(text, name);
+    return name;
+}
 
-        codeSection += startLabel + ":\n";
-        codeSection += "CMP " + node->children[0]->value + ", 0\n";
-        codeSection += "JE " + endLabel + "\n";
+// Flattens a chain of string '+' into its operands in order, merging
+// adjacent literals (int literals included) into a single piece of text.
+std::vector<CodeGenerator::StringPart> CodeGenerator::stringParts(const ASTNode& expression,
+                                                                  const std::string& suffix) const {
+    std::vector<StringPart> parts;
+    auto addText = [&parts](const std::string& text) {
+        if (text.empty()) return;
+        if (!parts.empty() && !parts.back().value) {
+            parts.back().text += text;
+        } else {
+            parts.push_back({ nullptr, text });
+        }
+    };
 
-        generateNode(node->children[1]);
+    std::vector<const ASTNode*> pending { &expression };
+    while (!pending.empty()) {
+        const ASTNode* node = pending.back();
+        pending.pop_back();
 
-        codeSection += "JMP " + startLabel + "\n";
-        codeSection += endLabel + ":\n";
+        std::string text;
+        if (node->kind == NodeKind::BinaryOp && node->value == "+" && node->type == Types::String) {
+            pending.push_back(node->children[1].get());
+            pending.push_back(node->children[0].get());
+        } else if (node->kind == NodeKind::String) {
+            addText(node->value);
+        } else if (literalText(*node, text)) {
+            addText(text);
+        } else {
+            parts.push_back({ node, "" });
+        }
     }
-    else if (node->nodeType == "For") {
-        std::string startLabel = newLabel();
-        std::string endLabel = newLabel();
+    addText(suffix);
+    return parts;
+}
 
-        generateNode(node->children[0]); 
+// Writes a string expression piece by piece to the runtime's current sink:
+// the output buffer, or with `building` a new string on the heap whose
+// address is left in AX. Calls made during a build would write into it, so
+// parts that call functions are evaluated and saved before it starts, as
+// are string parts other than variables, whose length is needed up front:
+// the heap room for the whole string is claimed once, from the lengths of
+// the string parts and the longest text of every other part.
+void CodeGenerator::writeString(const ASTNode& expression, const std::string& suffix, bool building) {
+    runtimeUsed = true;
+    std::vector<StringPart> parts = stringParts(expression, suffix);
 
-        codeSection += startLabel + ":\n";
-        codeSection += "CMP " + node->children[1]->value + ", 0\n";
-        codeSection += "JE " + endLabel + "\n";
+    size_t pushed = 0;
+    if (building) {
+        for (auto& part : parts) {
+            if (!part.value) continue;
+            bool variable = part.value->kind == NodeKind::Variable;
+            if (!callsFunction(*part.value) && (variable || typeOf(*part.value) != Types::String)) continue;
 
-        generateNode(node->children[3]); 
+            TypeId type = typeOf(*part.value);
+            if (type == Types::Float) {
+                loadFloat(*part.value);
+                codeSection += "SUB SP, 4\n";
+                codeSection += "MOV BX, SP\n";
+                codeSection += "FSTP DWORD PTR [BX]\n";
+                pushed += 4;
+            } else {
+                loadInt(*part.value);
+                codeSection += "PUSH AX\n";
+                pushed += 2;
+            }
+            part.saved = true;
+            part.pushed = pushed;
+        }
 
-        generateNode(node->children[2]); 
+        size_t length = 0;
+        for (const auto& part : parts) {
+            length += part.value ? maxTextLength(typeOf(*part.value)) : part.text.size();
+        }
+        codeSection += "MOV DX, " + std::to_string(length) + "\n";
+        for (const auto& part : parts) {
+            if (!part.value || typeOf(*part.value) != Types::String) continue;
+            if (part.saved) {
+                codeSection += "MOV BX, SP\n";
+                codeSection += "MOV SI, WORD PTR [BX+" + std::to_string(pushed - part.pushed) + "]\n";
+            } else {
+                codeSection += "MOV SI, " + operand(*part.value) + "\n";
+            }
+            codeSection += "CALL __rt_strlen\n";
+            codeSection += "ADD DX, CX\n";
+            codeSection += "JC __rt_no_memory\n";
+        }
+        codeSection += "MOV CX, DX\n";
+        codeSection += "CALL __rt_begin_string\n";
+    }
 
-        codeSection += "JMP " + startLabel + "\n";
-        codeSection += endLabel + ":\n";
+    for (const auto& part : parts) {
+        writePart(part, pushed);
     }
-    else if (node->nodeType == "Function") {
-        codeSection += node->value + ":\n";
 
-        for (const auto& child : node->children) {
-            generateNode(child);
+    if (building) {
+        codeSection += "CALL __rt_end_string\n";
+        if (pushed > 0) codeSection += "ADD SP, " + std::to_string(pushed) + "\n";
+    }
+}
+
+void CodeGenerator::writePart(const StringPart& part, size_t pushed) {
+    if (!part.value) {
+        codeSection += "MOV SI, OFFSET " + stringConstant(part.text) + "\n";
+        codeSection += "MOV CX, " + std::to_string(part.text.size()) + "\n";
+        codeSection += "CALL __rt_write\n";
+        return;
+    }
+
+    const ASTNode& value = *part.value;
+    std::string saved;
+    if (part.saved) {
+        codeSection += "MOV BX, SP\n";
+        saved = "[BX+" + std::to_string(pushed - part.pushed) + "]";
+    }
+
+    switch (typeOf(value)) {
+    case Types::String:
+        if (part.saved) {
+            codeSection += "MOV SI, WORD PTR " + saved + "\n";
+        } else if (value.kind == NodeKind::Variable) {
+            codeSection += "MOV SI, " + operand(value) + "\n";
+        } else {
+            loadInt(value);
+            codeSection += "MOV SI, AX\n";
+        }
+        codeSection += "CALL __rt_write_str\n";
+        break;
+    case Types::Float:
+        if (part.saved) {
+            codeSection += "FLD DWORD PTR " + saved + "\n";
+        } else {
+            loadFloat(value);
+        }
+        codeSection += "CALL __rt_write_float\n";
+        break;
+    case Types::Char:
+        if (part.saved) {
+            codeSection += "MOV AL, BYTE PTR " + saved + "\n";
+        } else {
+            loadInt(value);
         }
+        codeSection += "CALL __rt_write_char\n";
+        break;
+    default:
+        if (part.saved) {
+            codeSection += "MOV AX, WORD PTR " + saved + "\n";
+        } else {
+            loadInt(value);
+        }
+        codeSection += "CALL __rt_write_int\n";
+        break;
+    }
+}
+
+// Ends the main program, flushing buffered output first, followed by the
+// runtime routines if any were used.
+std::string CodeGenerator::exitSection() const {
+    if (!runtimeUsed) return Runtime::Exit;
+    return std::string("CALL __rt_flush\n") + Runtime::Exit + "\n.DATA\n" + Runtime::Data + "\n.CODE\n" + Runtime::Code;
+}
 
-        codeSection += "RET\n";
+// Stores an expression into a variable of the given type. A variable that
+// already lives in the target (a tail-call temporary sharing its parameter's
+// slot, or `x = x;`) needs no code. With `replacing` the target holds a
+// string already, whose buffer the new one may take over.
+void CodeGenerator::store(const std::string& target, TypeId type, const ASTNode& value, bool replacing) {
+    if (value.kind == NodeKind::Variable && operand(value) == target) return;
+    if (type == Types::Float) {
+        loadFloat(value);
+        codeSection += "FSTP " + target + "\n";
+        return;
     }
-    else if (node->nodeType == "Return") {
-        if (!node->children.empty()) {
-            codeSection += "MOV RET, " + node->children[0]->value + "\n";
+
+    std::string text;
+    if (literalText(value, text) || value.kind == NodeKind::String) {
+        codeSection += "MOV " + target + ", " + (value.kind == NodeKind::String ? valueOf(value) : text) + "\n";
+        return;
+    }
+    loadInt(value);
+    keepString(value);
+    if (replacing && type == Types::String && value.kind != NodeKind::Variable) {
+        codeSection += "MOV BX, " + target + "\n";
+        codeSection += "CALL __rt_reuse_string\n";
+    }
+    codeSection += "MOV " + target + (types.sizeOf(type) == 1 ? ", AL\n" : ", AX\n");
+}
+
+// A string variable whose value (in AX) is copied somewhere else shares its
+// buffer from then on, so the runtime must not reuse it.
+void CodeGenerator::keepString(const ASTNode& value) {
+    if (value.kind != NodeKind::Variable || typeOf(value) != Types::String) return;
+    runtimeUsed = true;
+    codeSection += "CALL __rt_keep_string\n";
+}
+
+// Arguments are pushed left to right in the layout FrameAllocator gives the
+// callee's parameters: two words for a float (ints are converted first), one
+// for anything else (bytes widened). The caller pops them.
+void CodeGenerator::emitCall(const ASTNode& call) {
+    auto signature = parameterTypes.find(call.value);
+    size_t pushed = 0;
+    for (size_t i = 0; i < call.children.size(); ++i) {
+        const ASTNode& argument = *call.children[i];
+        bool known = signature != parameterTypes.end() && i < signature->second.size();
+        TypeId type = known ? signature->second[i] : typeOf(argument);
+
+        if (type == Types::Float) {
+            loadFloat(argument);
+            codeSection += "SUB SP, 4\n";
+            codeSection += "MOV BX, SP\n";
+            codeSection += "FSTP DWORD PTR [BX]\n";
+            pushed += 4;
+        } else {
+            loadInt(argument);
+            keepString(argument);
+            codeSection += "PUSH AX\n";
+            pushed += 2;
+        }
+    }
+    codeSection += "CALL " + call.value + "\n";
+    if (pushed > 0) {
+        codeSection += "ADD SP, " + std::to_string(pushed) + "\n";
+    }
+}
+
+void CodeGenerator::declareFunction(const ASTNode& function) {
+    std::vector<TypeId>& parameters = parameterTypes[function.name];
+    parameters.clear();
+    for (const auto& child : function.children) {
+        if (child->kind == NodeKind::Param) parameters.push_back(typeOf(*child));
+    }
+}
+
+void CodeGenerator::jumpIfFalse(const ASTNode& condition, const std::string& target) {
+    loadInt(condition);
+    codeSection += "CMP AX, 0\n";
+    codeSection += "JE " + target + "\n";
+}
+
+void CodeGenerator::emitReturn() {
+    if (!openFrames.empty()) {
+        codeSection += "MOV SP, BP\n";
+        codeSection += "POP BP\n";
+    }
+    codeSection += "RET\n";
+}
+
+void CodeGenerator::generateNode(const std::shared_ptr<ASTNode>& node, ASTVisitor* checker) {
+    if (checker) {
+        FusedVisitor fused(*checker, *this);
+        walk(node, fused);
+    } else {
+        walk(node, *this);
+    }
+}
+
+// Expressions are read off their parent statement and never descended into
+// themselves.
+bool CodeGenerator::enter(ASTNode& node) {
+    switch (node.kind) {
+    case NodeKind::Program:
+        // Top-level functions may be called before their definition.
+        for (const auto& child : node.children) {
+            if (child->kind == NodeKind::Function) declareFunction(*child);
+        }
+        return true;
+
+    case NodeKind::Block:
+        localScopes.emplace_back();
+        return true;
+
+    // Statements that read expressions are emitted on leave, once a fused
+    // checker has typed their operands.
+    case NodeKind::Declaration:
+    case NodeKind::Assignment:
+    case NodeKind::Return:
+    case NodeKind::FunctionCallStatement:
+    case NodeKind::Print:
+    case NodeKind::Input:
+        return true;
+
+    case NodeKind::Param:
+        if (!openFrames.empty()) {
+            localScopes.back()[node.name] = frameOperand(openFrames.back().offsets.at(&node), typeOf(node));
+        } else {
+            TypeId type = typeOf(node);
+            declareData(node.name, type, type == Types::Float ? "0.0" : "0");
+        }
+        return false;
+
+    case NodeKind::If:
+        labels.push_back({ newLabel(), newLabel() });
+        return true;
+
+    case NodeKind::While:
+        labels.push_back({ newLabel(), newLabel() });
+        codeSection += labels.back().first + ":\n";
+        return true;
+
+    case NodeKind::For:
+        labels.push_back({ newLabel(), newLabel() });
+        localScopes.emplace_back();
+        return true;
+
+    // The body is jumped over, so the code around it runs straight through.
+    case NodeKind::Function: {
+        declareFunction(node);
+        openFrames.push_back(frameAllocator.layout(node));
+        returnTypes.push_back(typeOf(node));
+        frameScopes.push_back(localScopes.size());
+        localScopes.emplace_back();
+        labels.push_back({ newLabel(), "" });
+        const FrameLayout& frame = openFrames.back();
+
+        codeSection += "JMP " + labels.back().first + "\n";
+        codeSection += node.name + ":\n";
+        codeSection += "; frame: " + std::to_string(frame.localSize) + " bytes for " +
+                       std::to_string(frame.localCount) + " locals in " + std::to_string(frame.slotCount) +
+                       " slots, " + std::to_string(frame.paramSize) + " bytes of parameters\n";
+        codeSection += "PUSH BP\n";
+        codeSection += "MOV BP, SP\n";
+        if (frame.localSize > 0) {
+            codeSection += "SUB SP, " + std::to_string(frame.localSize) + "\n";
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+// Conditions are lowered once their node has been visited, so that a fused
+// checker has typed them.
+void CodeGenerator::beforeChild(ASTNode& node, size_t position) {
+    if (node.kind == NodeKind::If && position == 1) {
+        codeSection += "; IF condition\n";
+        jumpIfFalse(*node.children[0], labels.back().first);
+    }
+    else if (node.kind == NodeKind::If && position == 2) {
+        codeSection += "JMP " + labels.back().second + "\n";
+        codeSection += labels.back().first + ":\n";
+    }
+    else if (node.kind == NodeKind::While && position == 1) {
+        jumpIfFalse(*node.children[0], labels.back().second);
+    }
+    else if (node.kind == NodeKind::For && position == 1) {
+        codeSection += labels.back().first + ":\n";
+    }
+    else if (node.kind == NodeKind::For && position == 2) {
+        const auto& condition = node.children[1];
+        if (condition->kind != NodeKind::Empty) {
+            jumpIfFalse(*condition, labels.back().second);
+        }
+    }
+}
+
+// A for loop runs its body before the increment clause.
+size_t CodeGenerator::childAt(const ASTNode& node, size_t position) const {
+    if (node.kind == NodeKind::For && node.children.size() == 4) {
+        if (position == 2) return 3;
+        if (position == 3) return 2;
+    }
+    return position;
+}
+
+void CodeGenerator::leave(ASTNode& node) {
+    switch (node.kind) {
+    case NodeKind::Declaration: {
+        TypeId type = typeOf(node);
+        bool local = !openFrames.empty();
+        std::string target = node.name;
+        if (local) {
+            target = frameOperand(openFrames.back().offsets.at(&node), type);
+        } else {
+            declareData(node.name, type, type == Types::Float ? "0.0" : "0");
+        }
+
+        if (!node.children.empty()) {
+            store(target, type, *node.children[0]);
+        } else if (local) {
+            // Frame slots are reused, so locals start from zero like globals.
+            codeSection += "MOV " + target + ", 0\n";
+        }
+
+        if (local) localScopes.back()[node.name] = target;
+        break;
+    }
+
+    case NodeKind::FunctionCallStatement:
+        emitCall(node);
+        // An unused float result is dropped from the FPU stack.
+        if (typeOf(node) == Types::Float) codeSection += "FSTP ST(0)\n";
+        break;
+
+    case NodeKind::Print:
+        writeString(*node.children[0], "\r\n", false);
+        break;
+
+    case NodeKind::Input:
+        runtimeUsed = true;
+        codeSection += "CALL __rt_read_int\n";
+        codeSection += "MOV " + operand(*node.children[0]) + ", AX\n";
+        break;
+
+    case NodeKind::Assignment:
+        store(operand(*node.children[0]), typeOf(*node.children[0]), *node.children[1], true);
+        break;
+
+    // Results are returned in AX, or in ST(0) for float functions.
+    case NodeKind::Return:
+        if (!node.children.empty()) {
+            if (!returnTypes.empty() && returnTypes.back() == Types::Float) {
+                loadFloat(*node.children[0]);
+            } else {
+                loadInt(*node.children[0]);
+                // A local dies with the frame; a global stays behind.
+                if (operand(*node.children[0]) == node.children[0]->value) keepString(*node.children[0]);
+            }
+        }
+        emitReturn();
+        break;
+
+    case NodeKind::If:
+        if (node.children.size() <= 2) {
+            codeSection += "JMP " + labels.back().second + "\n";
+            codeSection += labels.back().first + ":\n";
+        }
+        codeSection += labels.back().second + ":\n";
+        labels.pop_back();
+        break;
+
+    case NodeKind::While:
+    case NodeKind::For:
+        codeSection += "JMP " + labels.back().first + "\n";
+        codeSection += labels.back().second + ":\n";
+        labels.pop_back();
+        if (node.kind == NodeKind::For) localScopes.pop_back();
+        break;
+
+    case NodeKind::Block:
+        localScopes.pop_back();
+        break;
+
+    case NodeKind::Function: {
+        // A body ending in return already has its epilogue.
+        const ASTNode& body = *node.children.back();
+        if (body.children.empty() || body.children.back()->kind != NodeKind::Return) {
+            emitReturn();
+        }
+        codeSection += labels.back().first + ":\n";
+        labels.pop_back();
+        if (reportFrames) {
+            frames.push_back(std::move(openFrames.back()));
+            frames.back().offsets.clear();
         }
-        codeSection += "RET\n";
+        openFrames.pop_back();
+        returnTypes.pop_back();
+        frameScopes.pop_back();
+        localScopes.pop_back();
+        break;
     }
+
+    default:
+        break;
+    }
+}
+
+std::string CodeGenerator::generate(const std::shared_ptr<ASTNode>& root, ASTVisitor* checker) {
+    generateNode(root, checker);
+    std::string text = ".DATA\n" + flushData() + "\n";
+    if (!constSection.empty()) text += ".CONST\n" + constSection + "\n";
+    constSection.clear();
+    return text + ".CODE\n" + codeSection + exitSection();
+}
+
+void CodeGenerator::emit(const std::shared_ptr<ASTNode>& statement, std::ostream& out, ASTVisitor* checker) {
+    codeSection.clear();
+    generateNode(statement, checker);
+    std::string dataSection = flushData();
+
+    if (!dataSection.empty()) out << ".DATA\n" << dataSection;
+    if (!constSection.empty()) out << ".CONST\n" << constSection;
+    if (!codeSection.empty()) out << ".CODE\n" << codeSection;
+    constSection.clear();
 }
 
-std::string CodeGenerator::generate(const std::shared_ptr<ASTNode>& root) {
-    generateNode(root);
-    return dataSection + "\n" + codeSection;
+void CodeGenerator::finish(std::ostream& out) {
+    out << ".CODE\n" << exitSection();
 }
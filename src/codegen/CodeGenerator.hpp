@@ -2,21 +2,100 @@
 #define CODE_GENERATOR_HPP
 
 #include "../parser/Parser.hpp"
+#include "../symbol/ASTVisitor.hpp"
+#include "../symbol/Types.hpp"
+#include "FrameAllocator.hpp"
 #include <string>
 #include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-class CodeGenerator {
+class CodeGenerator : public ASTVisitor {
 public:
-    CodeGenerator();
-    std::string generate(const std::shared_ptr<ASTNode>& root);
+    // With reportFrames the layout of every function is kept for frameReport().
+    explicit CodeGenerator(bool reportFrames = false);
+    // With a checker, both run in one fused traversal of the tree.
+    std::string generate(const std::shared_ptr<ASTNode>& root, ASTVisitor* checker = nullptr);
+    // Generates one top-level statement and writes it out right away.
+    void emit(const std::shared_ptr<ASTNode>& statement, std::ostream& out, ASTVisitor* checker = nullptr);
+    // Ends a program written with emit(): the exit and the runtime routines, if used.
+    void finish(std::ostream& out);
+
+    bool enter(ASTNode& node) override;
+    void leave(ASTNode& node) override;
+    void beforeChild(ASTNode& node, size_t position) override;
+    size_t childAt(const ASTNode& node, size_t position) const override;
+
+    // Frame layout of every function generated so far; empty unless requested.
+    const std::vector<FrameLayout>& frameReport() const { return frames; }
 
 private:
+    // A variable or constant waiting to be laid out in the data section.
+    struct DataEntry {
+        std::string name;
+        TypeId type;
+        std::string initial;
+    };
+
+    // A piece of a flattened string concatenation: literal text, or a value
+    // converted and written at run time.
+    struct StringPart {
+        const ASTNode* value; // nullptr for text
+        std::string text;
+        bool saved = false;   // evaluated before the writes and kept on the stack
+        size_t pushed = 0;    // bytes on the stack once it was saved
+    };
+
     int labelCount;
-    std::string dataSection;
+    TypeTable types;
+    std::vector<DataEntry> dataEntries;
+    size_t dataOffset = 0;
+    std::unordered_map<std::string, std::string> floatConstants;
     std::string codeSection;
+    // Labels of the If/While/For statements currently open.
+    std::vector<std::pair<std::string, std::string>> labels;
+
+    FrameAllocator frameAllocator;
+    std::vector<FrameLayout> openFrames;
+    std::vector<FrameLayout> frames;
+    bool reportFrames;
+    std::vector<TypeId> returnTypes; // of the functions being generated
+    std::unordered_map<std::string, std::vector<TypeId>> parameterTypes;
+    // Frame operands of the locals and parameters in scope, innermost last.
+    std::vector<std::unordered_map<std::string, std::string>> localScopes;
+    std::vector<size_t> frameScopes; // first scope of each open function
+
+    // Read-only string literals, pooled by content.
+    std::unordered_map<std::string, std::string> stringLiterals;
+    std::string constSection;
+    bool runtimeUsed = false;
 
-    void generateNode(const std::shared_ptr<ASTNode>& node);
+    void generateNode(const std::shared_ptr<ASTNode>& node, ASTVisitor* checker);
     std::string newLabel();
+    TypeId typeOf(const ASTNode& node) const;
+    void declareData(const std::string& name, TypeId type, const std::string& initial = "0");
+    std::string flushData();
+    std::string floatConstant(const std::string& literal);
+    bool floatOperand(const ASTNode& value, std::string& text, bool& integer);
+    void loadFloat(const ASTNode& expression);
+    void compareFloats(const ASTNode& comparison);
+    std::string frameOperand(int offset, TypeId type) const;
+    std::string operand(const ASTNode& value) const;
+    std::string valueOf(const ASTNode& value);
+    void store(const std::string& target, TypeId type, const ASTNode& value, bool replacing = false);
+    void keepString(const ASTNode& value);
+    void declareFunction(const ASTNode& function);
+    void emitCall(const ASTNode& call);
+    void jumpIfFalse(const ASTNode& condition, const std::string& target);
+    void emitReturn();
+    void loadInt(const ASTNode& expression);
+    std::string stringConstant(const std::string& text);
+    std::vector<StringPart> stringParts(const ASTNode& expression, const std::string& suffix) const;
+    void writeString(const ASTNode& expression, const std::string& suffix, bool building);
+    void writePart(const StringPart& part, size_t pushed);
+    std::string exitSection() const;
 };
 
 #endif
@@ -0,0 +1,184 @@
+#include "FrameAllocator.hpp"
+#include "../symbol/ASTVisitor.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct LiveRange {
+    const ASTNode* declaration;
+    TypeId type;
+    size_t start;
+    size_t end;
+};
+
+// Numbers nodes in walk order and records the live range of every local.
+class LivenessVisitor : public ASTVisitor {
+public:
+    LivenessVisitor(const TypeTable& types, const ASTNode& function) : types(types), function(function) {}
+
+    std::vector<LiveRange> ranges;
+
+    bool enter(ASTNode& node) override {
+        size_t position = counter++;
+        switch (node.kind) {
+        case NodeKind::Function:
+            if (&node != &function) return false;
+            scopes.emplace_back();
+            break;
+        case NodeKind::Block:
+            scopes.emplace_back();
+            break;
+        case NodeKind::For:
+            scopes.emplace_back();
+            loops.push_back({ position, {} });
+            break;
+        case NodeKind::While:
+            loops.push_back({ position, {} });
+            break;
+        case NodeKind::Variable:
+            use(node.value, position);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // A for loop repeats from its condition on, so only variables declared
+    // before that point live across iterations.
+    void beforeChild(ASTNode& node, size_t position) override {
+        if (node.kind == NodeKind::For && position == 1) {
+            loops.back().start = counter;
+        }
+    }
+
+    void leave(ASTNode& node) override {
+        switch (node.kind) {
+        case NodeKind::Function:
+            // Left for nested functions too, whose enter pushed nothing.
+            if (&node == &function) scopes.pop_back();
+            break;
+        case NodeKind::Block:
+            scopes.pop_back();
+            break;
+        case NodeKind::For:
+            closeLoop();
+            scopes.pop_back();
+            break;
+        case NodeKind::While:
+            closeLoop();
+            break;
+        case NodeKind::Declaration:
+            // Visible only after its initializer, like in the analyzer.
+            scopes.back()[node.name] = ranges.size();
+            ranges.push_back({ &node, typeOf(node), counter, counter });
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    struct Loop {
+        size_t start;
+        std::vector<size_t> used;
+    };
+
+    const TypeTable& types;
+    const ASTNode& function;
+    size_t counter = 0;
+    std::vector<std::unordered_map<std::string, size_t>> scopes;
+    std::vector<Loop> loops;
+
+    TypeId typeOf(const ASTNode& node) const {
+        return node.type != Types::Unknown ? node.type : types.lookup(node.typeName);
+    }
+
+    void use(const std::string& name, size_t position) {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it == scope->end()) continue;
+
+            LiveRange& range = ranges[it->second];
+            range.end = std::max(range.end, position);
+            for (auto& loop : loops) {
+                if (range.start <= loop.start) loop.used.push_back(it->second);
+            }
+            return;
+        }
+        // Parameters and globals are not allocated here.
+    }
+
+    void closeLoop() {
+        for (size_t index : loops.back().used) {
+            ranges[index].end = std::max(ranges[index].end, counter);
+        }
+        loops.pop_back();
+    }
+};
+
+}
+
+FrameAllocator::FrameAllocator(const TypeTable& types) : types(types) {}
+
+FrameLayout FrameAllocator::layout(ASTNode& function) const {
+    FrameLayout frame;
+    frame.function = function.name;
+
+    // Arguments are pushed left to right, floats as two words and anything
+    // else as one, so the last parameter sits right above the return
+    // address at [BP+4].
+    int paramOffset = 4;
+    for (auto it = function.children.rbegin(); it != function.children.rend(); ++it) {
+        const ASTNode& param = **it;
+        if (param.kind != NodeKind::Param) continue;
+
+        TypeId type = param.type != Types::Unknown ? param.type : types.lookup(param.typeName);
+        size_t size = std::max<size_t>(2, (types.sizeOf(type) + 1) & ~size_t(1));
+        frame.offsets[&param] = paramOffset;
+        paramOffset += static_cast<int>(size);
+    }
+    frame.paramSize = static_cast<size_t>(paramOffset - 4);
+
+    LivenessVisitor liveness(types, function);
+    std::shared_ptr<ASTNode> root(std::shared_ptr<ASTNode>(), &function);
+    walk(root, liveness);
+
+    // Linear scan over ranges in declaration order: a slot is released once
+    // the last use of its occupant lies before the next declaration.
+    struct Slot {
+        int offset;
+        size_t size;
+        size_t busyUntil;
+        bool taken;
+    };
+    std::vector<Slot> slots;
+
+    for (const auto& range : liveness.ranges) {
+        size_t size = std::max<size_t>(1, types.sizeOf(range.type));
+        size_t align = types.alignOf(range.type);
+
+        Slot* chosen = nullptr;
+        for (auto& slot : slots) {
+            if (slot.taken && slot.busyUntil < range.start) slot.taken = false;
+            if (!chosen && !slot.taken && slot.size == size) chosen = &slot;
+        }
+
+        if (!chosen) {
+            frame.localSize += size;
+            frame.localSize = (frame.localSize + align - 1) / align * align;
+            slots.push_back({ -static_cast<int>(frame.localSize), size, 0, false });
+            chosen = &slots.back();
+        }
+
+        chosen->taken = true;
+        chosen->busyUntil = range.end;
+        frame.offsets[range.declaration] = chosen->offset;
+    }
+
+    frame.localSize = (frame.localSize + 1) & ~size_t(1); // keep SP word aligned
+    frame.localCount = liveness.ranges.size();
+    frame.slotCount = slots.size();
+    return frame;
+}
@@ -0,0 +1,34 @@
+#ifndef FRAME_ALLOCATOR_HPP
+#define FRAME_ALLOCATOR_HPP
+
+#include "../symbol/ASTNode.hpp"
+#include "../symbol/Types.hpp"
+#include <string>
+#include <unordered_map>
+
+// Stack frame of one function, addressed from BP: parameters at positive
+// offsets above the saved BP and return address, locals at negative ones.
+struct FrameLayout {
+    std::string function;
+    size_t localSize = 0;
+    size_t paramSize = 0;
+    size_t localCount = 0;
+    size_t slotCount = 0;
+    std::unordered_map<const ASTNode*, int> offsets; // Declaration/Param node -> BP offset
+};
+
+// Lays out a function's frame. Each local gets a live range from its
+// declaration to its last use (stretched to the end of any loop that uses
+// it but was entered after it was declared), and locals whose ranges don't
+// overlap share a slot of the same size. Nested functions get frames of
+// their own and are skipped.
+class FrameAllocator {
+public:
+    explicit FrameAllocator(const TypeTable& types);
+    FrameLayout layout(ASTNode& function) const;
+
+private:
+    const TypeTable& types;
+};
+
+#endif
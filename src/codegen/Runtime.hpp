@@ -0,0 +1,41 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+// Support routines appended to programs that print, read input or build
+// strings at run time. Console I/O goes through DOS (INT 21h) in batches:
+// output is collected in a buffer that is written with a single call when it
+// fills up, before input is read and at exit, and input is read a buffer at a
+// time. While a string is being built, the same write routines append to a
+// heap instead of the output buffer, so a concatenation is assembled in place
+// with no intermediate strings. Room for the whole string is checked when it
+// begins; a string that does not fit ends the program with an error.
+//
+// The heap is never collected. An assignment gives the variable's old string
+// back when it was the last one built before the new one and was never
+// copied, so `s = s + x;` or `s = "a" + i;` in a loop keeps one buffer. Any
+// other string stays on the heap until the program ends: one copied to
+// another variable or passed on as an argument, one with newer strings built
+// after it, and those of a declaration repeated in a loop.
+//
+//   __rt_write          CX bytes at DS:SI
+//   __rt_write_str      zero-terminated string at DS:SI
+//   __rt_strlen         length of the zero-terminated string at DS:SI in CX
+//   __rt_write_int      AX as a signed decimal
+//   __rt_write_char     AL
+//   __rt_write_float    ST(0) with two decimals, popped
+//   __rt_begin_string   redirects writes to a new string of at most CX bytes
+//   __rt_end_string     terminates the string, returns its address in AX
+//   __rt_keep_string    marks the string at AX as held by more than one owner
+//   __rt_reuse_string   AX replacing BX in a variable: returns the address to store
+//   __rt_read_int       next integer from standard input in AX
+//   __rt_flush          writes out the buffered output
+//
+// The routines clobber AX, BX, CX, DX, SI, DI and ES.
+namespace Runtime {
+    extern const char* const Data;
+    extern const char* const Code;
+    // Returns to DOS; the output is flushed first if the runtime is used.
+    extern const char* const Exit;
+}
+
+#endif
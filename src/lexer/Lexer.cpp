@@ -2,41 +2,50 @@
 #include <cctype>
 #include <iostream>
 
-Lexer::Lexer(const std::string& source) : source(source), currentPosition(0) {}
+Lexer::Lexer(const std::string& source) : reader(source) {}
+
+Lexer::Lexer(std::istream& input) : reader(input) {}
+
+Lexer::Lexer(int fileDescriptor) : reader(fileDescriptor) {}
 
 Token Lexer::nextToken() {
-    while (currentPosition < source.length()) {
-        char currentChar = source[currentPosition];
+    while (!reader.atEnd()) {
+        char currentChar = reader.peek();
 
         if (std::isspace(currentChar)) {
-            currentPosition++;
+            reader.get();
             continue;
         }
 
-        if (currentChar == '/' && currentPosition + 1 < source.length() && source[currentPosition + 1] == '/') {
-            currentPosition += 2; 
-            while (currentPosition < source.length() && source[currentPosition] != '\n') {
-                currentPosition++;
+        if (currentChar == '/' && reader.peek(1) == '/') {
+            reader.get();
+            reader.get();
+            while (!reader.atEnd() && reader.peek() != '\n') {
+                reader.get();
             }
             continue; 
         }
 
-        if (std::isalpha(currentChar)) return readIdentifierOrKeyword();
-
-        if (std::isdigit(currentChar)) return readNumber();
+        size_t start = reader.position();
+        Token token;
 
-        if (currentChar == '"') return readString();
+        if (std::isalpha(currentChar)) token = readIdentifierOrKeyword();
+        else if (std::isdigit(currentChar)) token = readNumber();
+        else if (currentChar == '"') token = readString();
+        else token = readOperatorOrSymbol();
 
-        return readOperatorOrSymbol();
+        token.start = start;
+        token.end = reader.position();
+        return token;
     }
 
-    return { TokenType::EndOfFile, "" };
+    return { TokenType::EndOfFile, "", reader.position(), reader.position() };
 }
 
 Token Lexer::readIdentifierOrKeyword() {
     std::string value;
-    while (currentPosition < source.length() && std::isalnum(source[currentPosition])) {
-        value += source[currentPosition++];
+    while (!reader.atEnd() && std::isalnum(reader.peek())) {
+        value += reader.get();
     }
 
     // Check for specific type keywords first
@@ -57,27 +66,42 @@ Token Lexer::readIdentifierOrKeyword() {
 
 Token Lexer::readNumber() {
     std::string value;
-    while (currentPosition < source.length() && std::isdigit(source[currentPosition])) {
-        value += source[currentPosition++];
+    while (!reader.atEnd() && std::isdigit(reader.peek())) {
+        value += reader.get();
+    }
+    // Fractional part of a float literal, e.g. 2.5
+    if (reader.peek() == '.' && std::isdigit(reader.peek(1))) {
+        value += reader.get();
+        while (!reader.atEnd() && std::isdigit(reader.peek())) {
+            value += reader.get();
+        }
     }
     return { TokenType::Number, value };
 }
 
 Token Lexer::readString() {
     std::string value;
-    currentPosition++; 
+    reader.get(); 
 
-    while (currentPosition < source.length() && source[currentPosition] != '"') {
-        value += source[currentPosition++];
+    while (!reader.atEnd() && reader.peek() != '"') {
+        value += reader.get();
     }
 
-    if (currentPosition < source.length()) currentPosition++; 
+    if (!reader.atEnd()) reader.get(); 
 
     return { TokenType::String, value };
 }
 
 Token Lexer::readOperatorOrSymbol() {
-    char currentChar = source[currentPosition++];
+    char currentChar = reader.get();
+
+    // Comparison operators: <, >, <=, >=, ==, !=
+    if (currentChar == '<' || currentChar == '>' ||
+        ((currentChar == '=' || currentChar == '!') && reader.peek() == '=')) {
+        std::string op(1, currentChar);
+        if (reader.peek() == '=') op += reader.get();
+        return { TokenType::Operator, op };
+    }
 
     if (currentChar == '+' || currentChar == '-' || currentChar == '=' || currentChar == '*'
         || currentChar == '/' ) {
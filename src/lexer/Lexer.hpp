@@ -2,16 +2,19 @@
 #define LEXER_HPP
 
 #include "Token.hpp"
+#include "SourceReader.hpp"
+#include <istream>
 #include <string>
 
 class Lexer {
 public:
     Lexer(const std::string& source);
+    Lexer(std::istream& input);
+    Lexer(int fileDescriptor);
     Token nextToken();
 
 private:
-    std::string source;
-    size_t currentPosition;
+    SourceReader reader;
 
     Token readIdentifierOrKeyword();
     Token readNumber();
@@ -0,0 +1,61 @@
+#include "SourceReader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+SourceReader::SourceReader(const std::string& text)
+    : buffer(text.begin(), text.end()), end(text.length()), exhausted(true) {}
+
+SourceReader::SourceReader(std::istream& input, size_t windowSize)
+    : input(&input), buffer(std::max<size_t>(windowSize, 16)) {}
+
+SourceReader::SourceReader(int fileDescriptor, size_t windowSize)
+    : fileDescriptor(fileDescriptor), buffer(std::max<size_t>(windowSize, 16)) {}
+
+bool SourceReader::atEnd(size_t ahead) {
+    while (begin + ahead >= end && !exhausted) {
+        refill();
+    }
+    return begin + ahead >= end;
+}
+
+char SourceReader::peek(size_t ahead) {
+    return atEnd(ahead) ? '\0' : buffer[begin + ahead];
+}
+
+char SourceReader::get() {
+    if (atEnd()) return '\0';
+    offset++;
+    return buffer[begin++];
+}
+
+// Slides the unread tail to the front of the window and tops it up. Only the
+// lookahead still pending is kept; consumed characters are dropped.
+void SourceReader::refill() {
+    std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+    end -= begin;
+    begin = 0;
+
+    size_t space = buffer.size() - end;
+    if (space == 0) return;
+
+    if (input) {
+        input->read(buffer.data() + end, space);
+        size_t count = static_cast<size_t>(input->gcount());
+        end += count;
+        if (count == 0) exhausted = true;
+        return;
+    }
+
+    ssize_t count;
+    do {
+        count = ::read(fileDescriptor, buffer.data() + end, space);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0) {
+        throw std::runtime_error("Failed to read source input");
+    }
+    end += static_cast<size_t>(count);
+    if (count == 0) exhausted = true;
+}
@@ -0,0 +1,36 @@
+#ifndef SOURCE_READER_HPP
+#define SOURCE_READER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// Character source for the Lexer. Input coming from a stream or a file
+// descriptor is read through a fixed-size window that is refilled on demand,
+// so memory stays bounded no matter how long the program is.
+class SourceReader {
+public:
+    static const size_t DefaultWindowSize = 64 * 1024;
+
+    explicit SourceReader(const std::string& text);
+    explicit SourceReader(std::istream& input, size_t windowSize = DefaultWindowSize);
+    explicit SourceReader(int fileDescriptor, size_t windowSize = DefaultWindowSize);
+
+    bool atEnd(size_t ahead = 0);
+    char peek(size_t ahead = 0);
+    char get();
+    size_t position() const { return offset; }
+
+private:
+    std::istream* input = nullptr;
+    int fileDescriptor = -1;
+    std::vector<char> buffer;
+    size_t begin = 0;
+    size_t end = 0;
+    size_t offset = 0;
+    bool exhausted = false;
+
+    void refill();
+};
+
+#endif
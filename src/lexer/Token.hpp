@@ -2,6 +2,7 @@
 #define TOKEN_HPP
 
 #include <string>
+#include <cstddef>
 
 enum class TokenType {
     Keyword, 
@@ -21,6 +22,8 @@ enum class TokenType {
 struct Token {
     TokenType type;
     std::string value;
+    size_t start = 0; // offset of the first character in the source
+    size_t end = 0;   // offset just past the last character
 };
 
 #endif
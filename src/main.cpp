@@ -2,19 +2,339 @@
 #include "../src/parser/Parser.hpp"
 #include "../src/semantic/SemanticAnalyzer.hpp"
 #include "../src/codegen/CodeGenerator.hpp"
+#include "../src/optimizer/CallGraphOptimizer.hpp"
+#include "../src/parser/IncrementalParser.hpp"
 #include <iostream>
 #include <memory>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <iterator>
+#include <utility>
+#include <vector>
 
-void printAST(const std::shared_ptr<ASTNode>& node, int depth = 0) {
-    for (int i = 0; i < depth; ++i) std::cout << "  ";
-    std::cout << node->nodeType << ": " << node->value << std::endl;
-    for (const auto& child : node->children) {
-        printAST(child, depth + 1);
+void printAST(const std::shared_ptr<ASTNode>& root) {
+    std::vector<std::pair<const ASTNode*, int>> pending { { root.get(), 0 } };
+    while (!pending.empty()) {
+        const ASTNode* node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        for (int i = 0; i < depth; ++i) std::cout << "  ";
+        std::cout << node->nodeType << ": " << node->value << std::endl;
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            pending.push_back({ it->get(), depth + 1 });
+        }
     }
 }
 
-int main() {
+void printOptimizerStats(const OptimizerStats& stats, std::ostream& out) {
+    out << "Otimização: " << stats.pureFunctions << " função(ões) pura(s), " << stats.tailCalls
+        << " chamada(s) de cauda em laço, " << stats.inlinedCalls << " chamada(s) expandida(s), "
+        << stats.evaluatedCalls << " chamada(s) avaliada(s) em compilação" << std::endl;
+}
+
+// Compiles one top-level statement at a time, checking and emitting it in a
+// single fused traversal: nothing but the current statement and the lexer
+// window is kept in memory. With `optimize` the statement is checked first,
+// since the optimizer needs its types, and only optimized while the program
+// is free of errors.
+int compileStream(Lexer& lexer, std::ostream& out, bool optimize) {
+    Parser parser(lexer);
+    SemanticAnalyzer semanticAnalyzer;
+    CodeGenerator codeGenerator;
+    CallGraphOptimizer optimizer;
+
+    try {
+        while (auto statement = parser.parseNext()) {
+            if (!optimize) {
+                codeGenerator.emit(statement, out, &semanticAnalyzer);
+                continue;
+            }
+            semanticAnalyzer.analyzeStatement(statement);
+            if (semanticAnalyzer.errorCount() == 0) optimizer.optimizeStatement(statement);
+            codeGenerator.emit(statement, out);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
+    }
+    semanticAnalyzer.finish();
+    codeGenerator.finish(out);
+    out.flush();
+    if (optimize) printOptimizerStats(optimizer.stats(), std::cerr);
+    return semanticAnalyzer.errorCount() == 0 ? 0 : 1;
+}
+
+// Stress test for deeply nested input: runs every phase over nested blocks,
+// a long operator chain and nested parentheses, each `depth` levels deep.
+int runDepthBenchmark(size_t depth) {
+    std::string source;
+    source.reserve(depth * 12);
+    source.append(depth, '{');
+    source += "var x: int = 1;";
+    source.append(depth, '}');
+    source += "\nvar y: int = 1";
+    for (size_t i = 0; i < depth; ++i) source += " + 1";
+    source += ";\nvar z: int = ";
+    source.append(depth, '(');
+    source += "1";
+    source.append(depth, ')');
+    source += ";\n";
+
+    using Clock = std::chrono::steady_clock;
+    auto millis = [](Clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count();
+    };
+
+    try {
+        auto start = Clock::now();
+        Lexer lexer(source);
+        Parser parser(lexer);
+        auto ast = parser.parse();
+        std::cout << "parse:    " << millis(start) << " ms" << std::endl;
+
+        start = Clock::now();
+        SemanticAnalyzer semanticAnalyzer;
+        semanticAnalyzer.analyze(ast);
+        std::cout << "semantic: " << millis(start) << " ms" << std::endl;
+
+        start = Clock::now();
+        CallGraphOptimizer optimizer;
+        optimizer.optimize(ast);
+        std::cout << "optimize: " << millis(start) << " ms" << std::endl;
+
+        start = Clock::now();
+        CodeGenerator codeGenerator;
+        auto assembly = codeGenerator.generate(ast);
+        std::cout << "codegen:  " << millis(start) << " ms (" << assembly.size() << " bytes)" << std::endl;
+
+        start = Clock::now();
+        SemanticAnalyzer fusedAnalyzer;
+        CodeGenerator fusedGenerator;
+        fusedGenerator.generate(ast, &fusedAnalyzer);
+        std::cout << "fused:    " << millis(start) << " ms" << std::endl;
+
+        start = Clock::now();
+        ast.reset();
+        std::cout << "teardown: " << millis(start) << " ms" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Profundidade " << depth << ": OK" << std::endl;
+    return 0;
+}
+
+// Replays edits on a file through the incremental parser, the way someone
+// typing in the middle of it would: a `1` is typed after each of the first
+// `edits` digits past the middle of the file and deleted again, which keeps
+// a valid program valid. Reports the average work and time per edit.
+int runIncrementalBenchmark(const std::string& path, size_t edits) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::cerr << "Erro: não foi possível abrir " << path << std::endl;
+        return 1;
+    }
+    std::string source((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    std::vector<size_t> digits;
+    for (size_t i = source.size() / 2; i < source.size() && digits.size() < edits; ++i) {
+        if (std::isdigit(static_cast<unsigned char>(source[i]))) digits.push_back(i + 1);
+    }
+
+    size_t applied = 2 * digits.size();
+
+    using Clock = std::chrono::steady_clock;
+    auto micros = [](Clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+    };
+
+    try {
+        auto start = Clock::now();
+        IncrementalParser parser(source);
+        std::cout << "parse:    " << micros(start) / 1000 << " ms" << std::endl;
+
+        IncrementalStats total;
+        long long elapsed = 0;
+        long long slowest = 0;
+        for (size_t offset : digits) {
+            for (bool insert : { true, false }) {
+                start = Clock::now();
+                IncrementalStats stats = insert ? parser.applyEdit(offset, 0, "1")
+                                                : parser.applyEdit(offset, 1, "");
+                long long spent = micros(start);
+
+                elapsed += spent;
+                slowest = std::max(slowest, spent);
+                total.relexedTokens += stats.relexedTokens;
+                total.reusedNodes += stats.reusedNodes;
+                total.rebuiltNodes += stats.rebuiltNodes;
+            }
+        }
+
+        if (applied > 0) {
+            std::cout << "edit:     " << elapsed / static_cast<long long>(applied) << " us/edit (max "
+                      << slowest << " us)" << std::endl;
+            std::cout << "relexed:  " << total.relexedTokens / applied << " tokens/edit" << std::endl;
+            std::cout << "reused:   " << total.reusedNodes / applied << " nodes/edit" << std::endl;
+            std::cout << "rebuilt:  " << total.rebuiltNodes / applied << " nodes/edit" << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Edições " << applied << ": OK" << std::endl;
+    return 0;
+}
+
+// Compares a tree kept by the incremental parser, whose spans are relative to
+// the parent, with one the parser built from scratch, whose spans are absolute.
+bool sameTree(const ASTNode& incremental, const ASTNode& fresh) {
+    struct Pair {
+        const ASTNode* incremental;
+        const ASTNode* fresh;
+        size_t base;
+    };
+    std::vector<Pair> pending;
+    if (incremental.children.size() != fresh.children.size()) return false;
+    for (size_t i = 0; i < fresh.children.size(); ++i) {
+        pending.push_back({ incremental.children[i].get(), fresh.children[i].get(), 0 });
+    }
+
+    while (!pending.empty()) {
+        Pair pair = pending.back();
+        pending.pop_back();
+        const ASTNode& a = *pair.incremental;
+        const ASTNode& b = *pair.fresh;
+        if (a.nodeType != b.nodeType || a.value != b.value || a.children.size() != b.children.size()) return false;
+
+        size_t base = pair.base;
+        if (a.start != a.end) {
+            if (pair.base + a.start != b.start || pair.base + a.end != b.end) return false;
+            base += a.start;
+        } else if (b.start != b.end) {
+            return false;
+        }
+        for (size_t i = 0; i < a.children.size(); ++i) {
+            pending.push_back({ a.children[i].get(), b.children[i].get(), base });
+        }
+    }
+    return true;
+}
+
+// Checks the incremental parser against a full parse. At each of `positions`
+// offsets spread over the file (all of them by default), every text below is
+// inserted and also put in place of the character there, and the character
+// is deleted; each edit is undone right after. After every step the updated
+// tree must match a fresh parse of the text, and both must agree on whether
+// it parses at all.
+// The edits open and close blocks, statements, comments and strings, which
+// is where a region can be cut in the wrong place.
+int runIncrementalCheck(const std::string& path, size_t positions) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::cerr << "Erro: não foi possível abrir " << path << std::endl;
+        return 1;
+    }
+    std::string source((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    static const std::vector<std::string> insertions = { ";", "{", "}", "/*", "*/", "\"", " +", "1" };
+    size_t step = positions == 0 || positions > source.size() ? 1 : source.size() / positions;
+    size_t checked = 0;
+
+    try {
+        IncrementalParser parser(source);
+
+        // Applies one edit to both sides and compares them.
+        auto edit = [&](size_t offset, size_t removedLength, const std::string& insertedText) {
+            bool updated = true;
+            try {
+                parser.applyEdit(offset, removedLength, insertedText);
+            } catch (const std::exception&) {
+                updated = false;
+            }
+
+            std::string text = parser.text();
+            std::shared_ptr<ASTNode> expected;
+            try {
+                Lexer lexer(text);
+                Parser fresh(lexer);
+                expected = fresh.parse();
+            } catch (const std::exception&) {
+            }
+
+            checked++;
+            if (updated != (expected != nullptr) || (updated && !sameTree(*parser.tree(), *expected))) {
+                std::cerr << "Erro: árvore incremental difere da análise completa após editar a posição "
+                          << offset << " (removidos " << removedLength << ", inseridos \"" << insertedText
+                          << "\")" << std::endl;
+                return false;
+            }
+            return true;
+        };
+
+        for (size_t offset = 0; offset <= source.size(); offset += step) {
+            for (const auto& text : insertions) {
+                if (!edit(offset, 0, text) || !edit(offset, text.size(), "")) return 1;
+            }
+            if (offset == source.size()) break;
+
+            std::string replaced = source.substr(offset, 1);
+            for (const auto& text : insertions) {
+                if (!edit(offset, 1, text) || !edit(offset, text.size(), replaced)) return 1;
+            }
+            if (!edit(offset, 1, "") || !edit(offset, 0, replaced)) return 1;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Verificações " << checked << ": OK" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Uso: compilador [-O] <arquivo> | compilador [-O] - (lê da entrada padrão)
+    //      compilador --stress-depth <n>
+    //      compilador --incremental <arquivo> [edições]
+    //      compilador --incremental-check <arquivo> [posições]
+    if (argc > 2 && std::string(argv[1]) == "--stress-depth") {
+        return runDepthBenchmark(std::stoul(argv[2]));
+    }
+    if (argc > 2 && std::string(argv[1]) == "--incremental") {
+        return runIncrementalBenchmark(argv[2], argc > 3 ? std::stoul(argv[3]) : 100);
+    }
+    if (argc > 2 && std::string(argv[1]) == "--incremental-check") {
+        return runIncrementalCheck(argv[2], argc > 3 ? std::stoul(argv[3]) : 0);
+    }
+
+    bool optimize = argc > 1 && std::string(argv[1]) == "-O";
+    if (optimize) {
+        argc--;
+        argv++;
+    }
+
+    if (argc > 1) {
+        std::string path = argv[1];
+        if (path == "-") {
+            Lexer lexer(0);
+            return compileStream(lexer, std::cout, optimize);
+        }
+
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            std::cerr << "Erro: não foi possível abrir " << path << std::endl;
+            return 1;
+        }
+        Lexer lexer(input);
+        return compileStream(lexer, std::cout, optimize);
+    }
+
     std::string source = R"(
         var fat: int = fatorial(numero);
     )";
@@ -22,7 +342,7 @@ int main() {
     Lexer lexer(source);
     Parser parser(lexer);
     SemanticAnalyzer semanticAnalyzer;
-    CodeGenerator codeGenerator;
+    CodeGenerator codeGenerator(true);
 
     try {
         auto ast = parser.parse(); 
@@ -30,12 +350,27 @@ int main() {
         printAST(ast);
 
         semanticAnalyzer.analyze(ast);
-        std::cout << "\n==== Análise Semântica: OK ====" << std::endl;
+        if (semanticAnalyzer.errorCount() == 0) {
+            std::cout << "\n==== Análise Semântica: OK ====" << std::endl;
+
+            CallGraphOptimizer optimizer;
+            optimizer.optimize(ast);
+            printOptimizerStats(optimizer.stats(), std::cout);
+        } else {
+            std::cout << "\n==== Análise Semântica: " << semanticAnalyzer.errorCount() << " erro(s) ====" << std::endl;
+        }
 
         auto assembly = codeGenerator.generate(ast);
         std::cout << "\n==== Assembly Gerado ====" << std::endl;
         std::cout << assembly << std::endl;
 
+        std::cout << "==== Frames ====" << std::endl;
+        for (const auto& frame : codeGenerator.frameReport()) {
+            std::cout << frame.function << ": " << frame.localSize << " bytes de locais ("
+                      << frame.localCount << " variáveis em " << frame.slotCount << " slots), "
+                      << frame.paramSize << " bytes de parâmetros" << std::endl;
+        }
+
         // Opcional: salvar em arquivo
         std::ofstream outFile("output.asm");
         outFile << assembly;
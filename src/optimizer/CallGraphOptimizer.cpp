@@ -0,0 +1,603 @@
+#include "CallGraphOptimizer.hpp"
+#include "../symbol/ASTVisitor.hpp"
+#include <utility>
+
+namespace {
+
+// Collects the calls a function makes and whether it depends on anything
+// outside its own parameters and locals.
+class FunctionScanner : public ASTVisitor {
+public:
+    explicit FunctionScanner(const ASTNode& function) : function(function) {}
+
+    std::unordered_set<std::string> callees;
+    bool opaque = false;
+
+    bool enter(ASTNode& node) override {
+        switch (node.kind) {
+        case NodeKind::Function:
+            if (&node != &function) {
+                opaque = true;
+                return false;
+            }
+            scopes.emplace_back();
+            break;
+        case NodeKind::Block:
+        case NodeKind::For:
+            scopes.emplace_back();
+            break;
+        case NodeKind::Param:
+            scopes.back().insert(node.name);
+            break;
+        case NodeKind::Variable:
+            // Reads and assignments alike.
+            if (!isLocal(node.value)) opaque = true;
+            break;
+        case NodeKind::FunctionCall:
+        case NodeKind::FunctionCallStatement:
+            callees.insert(node.value);
+            break;
+        case NodeKind::Print:
+        case NodeKind::Input:
+            opaque = true;
+            break;
+        case NodeKind::Declaration:
+        case NodeKind::Return:
+        case NodeKind::Assignment:
+        case NodeKind::If:
+        case NodeKind::While:
+        case NodeKind::Number:
+        case NodeKind::String:
+        case NodeKind::BinaryOp:
+        case NodeKind::Empty:
+            break;
+        default:
+            opaque = true;
+            return false;
+        }
+        return true;
+    }
+
+    void leave(ASTNode& node) override {
+        switch (node.kind) {
+        case NodeKind::Function:
+            if (&node == &function) scopes.pop_back();
+            break;
+        case NodeKind::Block:
+        case NodeKind::For:
+            scopes.pop_back();
+            break;
+        case NodeKind::Declaration:
+            scopes.back().insert(node.name);
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    const ASTNode& function;
+    std::vector<std::unordered_set<std::string>> scopes;
+
+    bool isLocal(const std::string& name) const {
+        for (const auto& scope : scopes) {
+            if (scope.count(name)) return true;
+        }
+        return false;
+    }
+};
+
+std::shared_ptr<ASTNode> copyNode(const ASTNode& node) {
+    auto copy = std::make_shared<ASTNode>(node.nodeType, node.value);
+    copy->start = node.start;
+    copy->end = node.end;
+    copy->type = node.type;
+    return copy;
+}
+
+// Deep copy of an expression in which Variables naming a parameter are
+// replaced by a copy of the matching argument.
+std::shared_ptr<ASTNode> substitute(const ASTNode& expression,
+                                    const std::unordered_map<std::string, const ASTNode*>& arguments) {
+    struct Pending {
+        const ASTNode* from;
+        ASTNode* to;
+        bool substituting;
+    };
+    auto resolve = [&](const ASTNode& node, bool substituting) -> std::pair<const ASTNode*, bool> {
+        if (substituting && node.kind == NodeKind::Variable) {
+            auto it = arguments.find(node.value);
+            if (it != arguments.end()) return { it->second, false };
+        }
+        return { &node, substituting };
+    };
+
+    auto root = resolve(expression, true);
+    auto result = copyNode(*root.first);
+    std::vector<Pending> pending { { root.first, result.get(), root.second } };
+    while (!pending.empty()) {
+        Pending current = pending.back();
+        pending.pop_back();
+        for (const auto& child : current.from->children) {
+            auto source = resolve(*child, current.substituting);
+            auto copy = copyNode(*source.first);
+            current.to->children.push_back(copy);
+            pending.push_back({ source.first, copy.get(), source.second });
+        }
+    }
+    return result;
+}
+
+bool callsFunction(const ASTNode& expression) {
+    std::vector<const ASTNode*> pending { &expression };
+    while (!pending.empty()) {
+        const ASTNode* node = pending.back();
+        pending.pop_back();
+        if (node->kind == NodeKind::FunctionCall) return true;
+        for (const auto& child : node->children) {
+            pending.push_back(child.get());
+        }
+    }
+    return false;
+}
+
+bool isIntegral(TypeId type) {
+    return type == Types::Int || type == Types::Bool || type == Types::Char;
+}
+
+// Whether a value computed at compile time can be stored in the type.
+bool fits(long long value, TypeId type) {
+    switch (type) {
+    case Types::Int:
+        return value >= -32768 && value <= 32767;
+    case Types::Char:
+        return value >= 0 && value <= 255;
+    case Types::Bool:
+        return value == 0 || value == 1;
+    default:
+        return false;
+    }
+}
+
+}
+
+// Runs pure functions on integer arguments. Every statement and expression
+// costs a step; running out of steps, nesting too deep, overflowing int or
+// meeting anything it cannot evaluate abandons the evaluation.
+class CallGraphOptimizer::Interpreter {
+public:
+    Interpreter(const std::unordered_map<std::string, FunctionInfo>& functions, size_t steps)
+        : functions(functions), steps(steps) {}
+
+    bool call(const ASTNode& function, const std::vector<long long>& arguments, long long& result) {
+        if (depth > MaxEvaluationDepth) return false;
+
+        std::vector<std::unordered_map<std::string, long long>> caller;
+        caller.swap(scopes);
+        scopes.emplace_back();
+
+        size_t next = 0;
+        Flow flow = Flow::Fail;
+        for (const auto& child : function.children) {
+            if (child->kind == NodeKind::Param) {
+                if (next == arguments.size() || !isIntegral(child->type)) break;
+                scopes.back()[child->name] = arguments[next++];
+            } else if (child->kind == NodeKind::Block && next == arguments.size()) {
+                flow = execute(*child);
+            }
+        }
+
+        scopes.swap(caller);
+        if (flow != Flow::Return) return false;
+        result = returned;
+        return true;
+    }
+
+private:
+    enum class Flow { Next, Return, Fail };
+
+    struct Nesting {
+        size_t& depth;
+        explicit Nesting(size_t& depth) : depth(++depth) {}
+        ~Nesting() { --depth; }
+    };
+
+    const std::unordered_map<std::string, FunctionInfo>& functions;
+    size_t steps;
+    size_t depth = 0;
+    std::vector<std::unordered_map<std::string, long long>> scopes;
+    long long returned = 0;
+
+    bool tick() {
+        if (steps == 0 || depth > MaxEvaluationDepth) return false;
+        steps--;
+        return true;
+    }
+
+    long long* find(const std::string& name) {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) return &it->second;
+        }
+        return nullptr;
+    }
+
+    bool condition(const ASTNode& node, bool& holds) {
+        long long value = 1;
+        if (node.kind != NodeKind::Empty && !evaluate(node, value)) return false;
+        holds = value != 0;
+        return true;
+    }
+
+    Flow loop(const ASTNode& test, const ASTNode& body, const ASTNode* increment) {
+        while (true) {
+            bool holds = false;
+            if (!condition(test, holds)) return Flow::Fail;
+            if (!holds) return Flow::Next;
+
+            Flow flow = execute(body);
+            if (flow == Flow::Next && increment) flow = execute(*increment);
+            if (flow != Flow::Next) return flow;
+        }
+    }
+
+    Flow execute(const ASTNode& node) {
+        Nesting nesting(depth);
+        if (!tick()) return Flow::Fail;
+
+        switch (node.kind) {
+        case NodeKind::Block: {
+            scopes.emplace_back();
+            Flow flow = Flow::Next;
+            for (const auto& child : node.children) {
+                flow = execute(*child);
+                if (flow != Flow::Next) break;
+            }
+            scopes.pop_back();
+            return flow;
+        }
+        case NodeKind::Declaration: {
+            long long value = 0;
+            if (!isIntegral(node.type)) return Flow::Fail;
+            if (!node.children.empty() && !evaluate(*node.children[0], value)) return Flow::Fail;
+            scopes.back()[node.name] = value;
+            return Flow::Next;
+        }
+        case NodeKind::Assignment: {
+            long long value = 0;
+            long long* target = find(node.children[0]->value);
+            if (!target || !evaluate(*node.children[1], value)) return Flow::Fail;
+            *target = value;
+            return Flow::Next;
+        }
+        case NodeKind::Return:
+            if (node.children.empty() || !evaluate(*node.children[0], returned)) return Flow::Fail;
+            return Flow::Return;
+        case NodeKind::FunctionCallStatement: {
+            long long ignored = 0;
+            return evaluate(node, ignored) ? Flow::Next : Flow::Fail;
+        }
+        case NodeKind::For: {
+            scopes.emplace_back();
+            Flow flow = execute(*node.children[0]);
+            if (flow == Flow::Next) flow = loop(*node.children[1], *node.children[3], node.children[2].get());
+            scopes.pop_back();
+            return flow;
+        }
+        case NodeKind::While:
+            return loop(*node.children[0], *node.children[1], nullptr);
+        case NodeKind::If: {
+            bool holds = false;
+            if (!condition(*node.children[0], holds)) return Flow::Fail;
+            if (holds) return execute(*node.children[1]);
+            return node.children.size() > 2 ? execute(*node.children[2]) : Flow::Next;
+        }
+        case NodeKind::Empty:
+            return Flow::Next;
+        default:
+            return Flow::Fail;
+        }
+    }
+
+    bool evaluate(const ASTNode& node, long long& value) {
+        Nesting nesting(depth);
+        if (!tick()) return false;
+
+        switch (node.kind) {
+        case NodeKind::Number:
+            if (node.type != Types::Int || node.value.size() > 9) return false;
+            value = std::stoll(node.value);
+            return fits(value, Types::Int);
+        case NodeKind::Variable: {
+            long long* variable = find(node.value);
+            if (!variable) return false;
+            value = *variable;
+            return true;
+        }
+        case NodeKind::BinaryOp: {
+            long long left = 0;
+            long long right = 0;
+            if (!isIntegral(node.type)) return false;
+            if (!evaluate(*node.children[0], left) || !evaluate(*node.children[1], right)) return false;
+
+            const std::string& op = node.value;
+            if (op == "+") value = left + right;
+            else if (op == "-") value = left - right;
+            else if (op == "*") value = left * right;
+            else if (op == "/") {
+                if (right == 0) return false;
+                value = left / right;
+            }
+            else if (op == "<") value = left < right;
+            else if (op == ">") value = left > right;
+            else if (op == "<=") value = left <= right;
+            else if (op == ">=") value = left >= right;
+            else if (op == "==") value = left == right;
+            else if (op == "!=") value = left != right;
+            else return false;
+            return fits(value, node.type);
+        }
+        case NodeKind::FunctionCall:
+        case NodeKind::FunctionCallStatement: {
+            auto callee = functions.find(node.value);
+            if (callee == functions.end() || !callee->second.pure) return false;
+
+            std::vector<long long> arguments;
+            for (const auto& argument : node.children) {
+                arguments.push_back(0);
+                if (!evaluate(*argument, arguments.back())) return false;
+            }
+            return call(*callee->second.node, arguments, value);
+        }
+        default:
+            return false;
+        }
+    }
+};
+
+CallGraphOptimizer::CallGraphOptimizer(size_t stepBudget) : stepBudget(stepBudget) {}
+
+void CallGraphOptimizer::optimize(const std::shared_ptr<ASTNode>& root) {
+    std::vector<FunctionInfo*> added;
+    for (const auto& child : root->children) {
+        if (child->kind == NodeKind::Function) added.push_back(&addFunction(child));
+    }
+    settlePurity(added);
+    rewriteCalls(root);
+}
+
+void CallGraphOptimizer::optimizeStatement(const std::shared_ptr<ASTNode>& statement) {
+    if (statement->kind == NodeKind::Function) {
+        settlePurity({ &addFunction(statement) });
+    }
+    rewriteCalls(statement);
+}
+
+CallGraphOptimizer::FunctionInfo& CallGraphOptimizer::addFunction(const std::shared_ptr<ASTNode>& function) {
+    if (eliminateTailCall(*function)) statistics.tailCalls++;
+
+    FunctionScanner scanner(*function);
+    walk(function, scanner);
+
+    FunctionInfo& info = functions[function->name];
+    info.node = function;
+    info.callees = std::move(scanner.callees);
+    info.opaque = scanner.opaque;
+    return info;
+}
+
+// Starts from "pure unless opaque" and clears the flag of every function
+// that calls something impure or unknown until nothing changes, so mutually
+// recursive functions can still end up pure. Functions outside `pending`
+// are already settled.
+//
+// Only pure functions stay in the table afterwards: nothing else can be
+// evaluated or inlined (an inlinable body is pure by construction), and a
+// callee that is not found counts as impure anyway. This keeps the memory
+// of a streamed program from growing with its functions.
+void CallGraphOptimizer::settlePurity(const std::vector<FunctionInfo*>& pending) {
+    for (FunctionInfo* info : pending) {
+        info->pure = !info->opaque;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (FunctionInfo* info : pending) {
+            if (!info->pure) continue;
+            for (const auto& name : info->callees) {
+                auto callee = functions.find(name);
+                if (callee == functions.end() || !callee->second.pure) {
+                    info->pure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (FunctionInfo* info : pending) {
+        if (info->pure) {
+            statistics.pureFunctions++;
+            info->callees.clear();
+        } else {
+            std::string name = info->node->name;
+            functions.erase(name);
+        }
+    }
+}
+
+// Turns a final `return f(a, b);` in f into a jump back to the top: the body
+// runs inside an endless for loop and ends by assigning the new arguments to
+// the parameters through temporaries, so every argument sees the old values.
+bool CallGraphOptimizer::eliminateTailCall(ASTNode& function) {
+    if (function.children.empty()) return false;
+    auto body = function.children.back();
+    if (body->kind != NodeKind::Block || body->children.empty()) return false;
+
+    auto tail = body->children.back();
+    if (tail->kind != NodeKind::Return || tail->children.size() != 1) return false;
+    const auto& call = tail->children[0];
+    if (call->kind != NodeKind::FunctionCall || call->value != function.name) return false;
+
+    std::vector<const ASTNode*> params;
+    for (const auto& child : function.children) {
+        if (child->kind == NodeKind::Param) params.push_back(child.get());
+    }
+    if (params.size() != call->children.size()) return false;
+    for (size_t i = 0; i < params.size(); ++i) {
+        // An implicit int to float conversion would be lost.
+        if (call->children[i]->type != params[i]->type) return false;
+    }
+
+    auto loopBody = std::make_shared<ASTNode>("Block", "");
+    loopBody->start = body->start;
+    loopBody->end = body->end;
+    loopBody->children.assign(body->children.begin(), body->children.end() - 1);
+
+    std::vector<std::shared_ptr<ASTNode>> assignments;
+    for (size_t i = 0; i < params.size(); ++i) {
+        const ASTNode& param = *params[i];
+        const auto& argument = call->children[i];
+        if (argument->kind == NodeKind::Variable && argument->value == param.name) continue;
+
+        // Source identifiers start with a letter, so these names cannot clash.
+        std::string temporary = "__" + param.name;
+        auto declaration = std::make_shared<ASTNode>("Declaration", temporary + ":" + param.typeName);
+        declaration->type = param.type;
+        declaration->children.push_back(argument);
+        loopBody->children.push_back(declaration);
+
+        auto target = std::make_shared<ASTNode>("Variable", param.name);
+        auto value = std::make_shared<ASTNode>("Variable", temporary);
+        auto assignment = std::make_shared<ASTNode>("Assignment", "=");
+        target->type = value->type = assignment->type = param.type;
+        assignment->children.push_back(target);
+        assignment->children.push_back(value);
+        assignments.push_back(assignment);
+    }
+    loopBody->children.insert(loopBody->children.end(), assignments.begin(), assignments.end());
+
+    auto loop = std::make_shared<ASTNode>("ForLoop", "");
+    loop->start = body->start;
+    loop->end = body->end;
+    for (int i = 0; i < 3; ++i) {
+        loop->children.push_back(std::make_shared<ASTNode>("Empty", ""));
+    }
+    loop->children.push_back(loopBody);
+
+    body->children.assign(1, loop);
+    return true;
+}
+
+// Visits calls innermost first, so an argument is already folded or inlined
+// by the time the call around it is looked at.
+void CallGraphOptimizer::rewriteCalls(const std::shared_ptr<ASTNode>& root) {
+    std::vector<std::pair<ASTNode*, size_t>> calls;
+    std::vector<ASTNode*> pending { root.get() };
+    while (!pending.empty()) {
+        ASTNode* node = pending.back();
+        pending.pop_back();
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            ASTNode* child = node->children[i].get();
+            if (child->kind == NodeKind::FunctionCall) calls.push_back({ node, i });
+            pending.push_back(child);
+        }
+    }
+
+    for (auto site = calls.rbegin(); site != calls.rend(); ++site) {
+        std::shared_ptr<ASTNode>& slot = site->first->children[site->second];
+        auto callee = functions.find(slot->value);
+        if (callee == functions.end()) continue;
+
+        std::shared_ptr<ASTNode> replacement;
+        if (callee->second.pure && (replacement = evaluateCall(*slot, callee->second))) {
+            statistics.evaluatedCalls++;
+        } else if ((replacement = inlineCall(*slot, callee->second))) {
+            // An argument that still calls a function keeps a CALL here.
+            if (!callsFunction(*replacement)) statistics.inlinedCalls++;
+        }
+        if (replacement) slot = replacement;
+    }
+}
+
+std::shared_ptr<ASTNode> CallGraphOptimizer::evaluateCall(const ASTNode& call, const FunctionInfo& callee) const {
+    std::vector<long long> arguments;
+    for (const auto& argument : call.children) {
+        if (argument->kind != NodeKind::Number || argument->type != Types::Int) return nullptr;
+        if (argument->value.size() > 9) return nullptr;
+        arguments.push_back(std::stoll(argument->value));
+    }
+
+    long long result = 0;
+    Interpreter interpreter(functions, stepBudget);
+    if (!interpreter.call(*callee.node, arguments, result) || !fits(result, call.type)) return nullptr;
+
+    auto number = std::make_shared<ASTNode>("Number", std::to_string(result));
+    number->type = call.type;
+    return number;
+}
+
+// Inlines a function whose body is a single `return expression;` over its
+// parameters alone. Arguments must be free of side effects, and one that is
+// used more than once must be a plain operand so no work is repeated.
+std::shared_ptr<ASTNode> CallGraphOptimizer::inlineCall(const ASTNode& call, const FunctionInfo& callee) const {
+    const ASTNode& function = *callee.node;
+    const ASTNode& body = *function.children.back();
+    if (body.kind != NodeKind::Block || body.children.size() != 1) return nullptr;
+    const ASTNode& tail = *body.children[0];
+    if (tail.kind != NodeKind::Return || tail.children.size() != 1) return nullptr;
+    const ASTNode& expression = *tail.children[0];
+    if (expression.type != call.type) return nullptr;
+
+    std::unordered_map<std::string, const ASTNode*> arguments;
+    size_t next = 0;
+    for (const auto& child : function.children) {
+        if (child->kind != NodeKind::Param) continue;
+        if (next == call.children.size() || call.children[next]->type != child->type) return nullptr;
+        arguments[child->name] = call.children[next++].get();
+    }
+    if (next != call.children.size()) return nullptr;
+
+    std::unordered_map<std::string, size_t> uses;
+    size_t size = 0;
+    std::vector<const ASTNode*> pending { &expression };
+    while (!pending.empty()) {
+        const ASTNode* node = pending.back();
+        pending.pop_back();
+        if (++size > MaxInlineSize) return nullptr;
+
+        if (node->kind == NodeKind::Variable) {
+            if (!arguments.count(node->value)) return nullptr;
+            uses[node->value]++;
+        } else if (node->kind != NodeKind::Number && node->kind != NodeKind::String &&
+                   node->kind != NodeKind::BinaryOp) {
+            return nullptr;
+        }
+        for (const auto& child : node->children) {
+            pending.push_back(child.get());
+        }
+    }
+
+    for (const auto& argument : arguments) {
+        bool plain = true;
+        pending.assign(1, argument.second);
+        while (!pending.empty()) {
+            const ASTNode* node = pending.back();
+            pending.pop_back();
+            if (node->kind == NodeKind::FunctionCall) {
+                auto target = functions.find(node->value);
+                if (target == functions.end() || !target->second.pure) return nullptr;
+                plain = false;
+            } else if (node->kind == NodeKind::BinaryOp) {
+                plain = false;
+            }
+            for (const auto& child : node->children) {
+                pending.push_back(child.get());
+            }
+        }
+        if (!plain && uses[argument.first] > 1) return nullptr;
+    }
+
+    return substitute(expression, arguments);
+}
@@ -0,0 +1,58 @@
+#ifndef CALL_GRAPH_OPTIMIZER_HPP
+#define CALL_GRAPH_OPTIMIZER_HPP
+
+#include "../symbol/ASTNode.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct OptimizerStats {
+    size_t pureFunctions = 0;
+    size_t tailCalls = 0;
+    size_t inlinedCalls = 0; // only those that left no CALL behind
+    size_t evaluatedCalls = 0;
+};
+
+// Interprocedural pass over the top-level functions of a program that has
+// already been checked (it relies on ASTNode::type). Self tail calls become
+// loops, functions that touch no globals and call only pure functions are
+// marked pure, calls to a pure function with constant arguments are
+// evaluated at compile time, and calls to small leaf functions are inlined.
+class CallGraphOptimizer {
+public:
+    static constexpr size_t DefaultStepBudget = 100000;
+    static constexpr size_t MaxEvaluationDepth = 256;
+    static constexpr size_t MaxInlineSize = 32;
+
+    explicit CallGraphOptimizer(size_t stepBudget = DefaultStepBudget);
+
+    void optimize(const std::shared_ptr<ASTNode>& root);
+    // Optimizes one top-level statement; functions stay known to later calls.
+    void optimizeStatement(const std::shared_ptr<ASTNode>& statement);
+
+    const OptimizerStats& stats() const { return statistics; }
+
+private:
+    struct FunctionInfo {
+        std::shared_ptr<ASTNode> node;
+        std::unordered_set<std::string> callees;
+        bool opaque = false; // does I/O, uses globals, nested functions or unknown statements
+        bool pure = false;
+    };
+    class Interpreter;
+
+    std::unordered_map<std::string, FunctionInfo> functions; // pure ones, once settled
+    size_t stepBudget;
+    OptimizerStats statistics;
+
+    FunctionInfo& addFunction(const std::shared_ptr<ASTNode>& function);
+    void settlePurity(const std::vector<FunctionInfo*>& pending);
+    bool eliminateTailCall(ASTNode& function);
+    void rewriteCalls(const std::shared_ptr<ASTNode>& root);
+    std::shared_ptr<ASTNode> evaluateCall(const ASTNode& call, const FunctionInfo& callee) const;
+    std::shared_ptr<ASTNode> inlineCall(const ASTNode& call, const FunctionInfo& callee) const;
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "IncrementalParser.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+size_t shifted(size_t position, long delta) {
+    return static_cast<size_t>(static_cast<long>(position) + delta);
+}
+
+// Nodes without a span (expressions, parameters) keep start == end == 0 and
+// never move. A stored span may wrap around while a shift is pending, so only
+// equality tells the two apart.
+bool hasSpan(const ASTNode& node) {
+    return node.start != node.end;
+}
+
+bool endsStatement(const Token& token) {
+    return token.type == TokenType::Symbol && (token.value == ";" || token.value == "}");
+}
+
+void moveSpan(ASTNode& node, long delta) {
+    if (!hasSpan(node)) return;
+    node.start = shifted(node.start, delta);
+    node.end = shifted(node.end, delta);
+}
+
+}
+
+IncrementalParser::IncrementalParser(const std::string& source) : source(source) {
+    reparseAll();
+}
+
+// Returns the number of tokens lexed.
+size_t IncrementalParser::reparseAll() {
+    treeValid = false;
+
+    std::vector<Token> tokens;
+    Lexer lexer(source.str());
+    for (Token token = lexer.nextToken(); token.type != TokenType::EndOfFile; token = lexer.nextToken()) {
+        tokens.push_back(token);
+    }
+
+    Parser parser(tokens, 0, tokens.size());
+    root = parser.parse();
+    root->start = 0;
+    root->end = source.length();
+    makeRelative(root, 0);
+    pendingShifts.clear();
+    nodeCount = countNodes(root);
+    treeValid = true;
+    return tokens.size();
+}
+
+const std::shared_ptr<ASTNode>& IncrementalParser::tree() {
+    for (const auto& entry : pendingShifts) {
+        const auto& children = entry.first->children;
+        for (size_t i = entry.second.from; i < children.size(); ++i) {
+            moveSpan(*children[i], entry.second.delta);
+        }
+    }
+    pendingShifts.clear();
+    return root;
+}
+
+IncrementalStats IncrementalParser::applyEdit(size_t offset, size_t removedLength, const std::string& insertedText) {
+    if (offset > source.length() || removedLength > source.length() - offset) {
+        throw std::runtime_error("Edit range outside of source");
+    }
+
+    IncrementalStats stats;
+    long delta = static_cast<long>(insertedText.length()) - static_cast<long>(removedLength);
+    size_t removedEnd = offset + removedLength;
+    std::vector<PathStep> path;
+    if (treeValid) path = findPath(offset, removedEnd);
+    source.replace(offset, removedLength, insertedText);
+
+    if (!treeValid) {
+        stats.relexedTokens = reparseAll();
+        stats.rebuiltNodes = nodeCount;
+        return stats;
+    }
+
+    // Innermost container first; a Block only qualifies if the edit stays
+    // strictly between its braces.
+    for (size_t level = path.size(); level-- > 0;) {
+        const PathStep& container = path[level];
+        ASTNode& node = *container.node;
+        bool isProgram = level == 0;
+        if (!isProgram && (node.kind != NodeKind::Block || container.start >= offset || removedEnd >= container.end)) {
+            continue;
+        }
+
+        // Children that end before the edit or start after it are kept.
+        auto& children = node.children;
+        size_t relativeOffset = offset - container.start;
+        size_t relativeEnd = removedEnd - container.start;
+        size_t prefixEnd = 0;
+        size_t high = children.size();
+        while (prefixEnd < high) {
+            size_t middle = prefixEnd + (high - prefixEnd) / 2;
+            if (childEnd(node, middle) <= relativeOffset) prefixEnd = middle + 1;
+            else high = middle;
+        }
+        size_t suffixBegin = prefixEnd;
+        high = children.size();
+        while (suffixBegin < high) {
+            size_t middle = suffixBegin + (high - suffixBegin) / 2;
+            if (childStart(node, middle) < relativeEnd) suffixBegin = middle + 1;
+            else high = middle;
+        }
+
+        size_t regionStart = prefixEnd > 0 ? container.start + childEnd(node, prefixEnd - 1)
+                           : isProgram ? 0 : container.start + 1;
+        std::vector<Token> fresh;
+        if (!lexRegion(regionStart, container, delta, suffixBegin, fresh)) continue;
+
+        std::shared_ptr<ASTNode> parsed;
+        try {
+            Parser parser(fresh, 0, fresh.size());
+            parsed = parser.parse();
+        } catch (const std::exception&) {
+            if (!isProgram) continue;
+            // Only a parse of the whole text tells a real syntax error apart
+            // from a region that was cut in the wrong place.
+            stats.relexedTokens = reparseAll();
+            stats.rebuiltNodes = nodeCount;
+            return stats;
+        }
+
+        moveShift(node, suffixBegin);
+        size_t removed = 0;
+        for (size_t i = prefixEnd; i < suffixBegin; ++i) {
+            removed += releaseNodes(children[i]);
+        }
+        size_t rebuilt = 0;
+        for (const auto& child : parsed->children) {
+            makeRelative(child, container.start);
+            rebuilt += countNodes(child);
+        }
+
+        // Overwrite in place so the siblings only move when the count changes.
+        const auto& statements = parsed->children;
+        size_t common = std::min(suffixBegin - prefixEnd, statements.size());
+        std::copy(statements.begin(), statements.begin() + common, children.begin() + prefixEnd);
+        children.erase(children.begin() + prefixEnd + common, children.begin() + suffixBegin);
+        children.insert(children.begin() + prefixEnd + common, statements.begin() + common, statements.end());
+
+        // Everything after the new children, in this container and in each
+        // one around it, moves by delta.
+        size_t trailing = prefixEnd + statements.size();
+        auto shift = pendingShifts.find(&node);
+        if (shift != pendingShifts.end()) shift->second.from = trailing;
+        shiftAfter(node, trailing, delta);
+        for (size_t up = level; up > 0; --up) {
+            const PathStep& step = path[up];
+            step.node->end = shifted(step.node->end, delta);
+            shiftAfter(*step.parent, step.index + 1, delta);
+        }
+        root->end = source.length();
+
+        nodeCount = nodeCount - removed + rebuilt;
+        stats.relexedTokens = fresh.size();
+        stats.rebuiltNodes = rebuilt;
+        stats.reusedNodes = nodeCount - rebuilt;
+        return stats;
+    }
+
+    treeValid = false;
+    throw std::runtime_error("No enclosing block found for edit");
+}
+
+// Nodes whose span holds [offset, removedEnd), from the Program down, with
+// their absolute spans before the edit.
+std::vector<IncrementalParser::PathStep> IncrementalParser::findPath(size_t offset, size_t removedEnd) const {
+    std::vector<PathStep> path { { root.get(), nullptr, 0, 0, source.length() } };
+
+    while (true) {
+        const PathStep& step = path.back();
+        const ASTNode& node = *step.node;
+        size_t relativeOffset = offset - step.start;
+
+        // Children are ordered by start; those without a span come first.
+        size_t low = 0;
+        size_t high = node.children.size();
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (childStart(node, middle) <= relativeOffset) low = middle + 1;
+            else high = middle;
+        }
+        if (low == 0) break;
+
+        size_t index = low - 1;
+        ASTNode* child = node.children[index].get();
+        if (!hasSpan(*child)) break;
+        size_t start = step.start + childStart(node, index);
+        size_t end = step.start + childEnd(node, index);
+        if (removedEnd > end) break;
+        path.push_back({ child, step.node, index, start, end });
+    }
+    return path;
+}
+
+// Lexes the edited text from regionStart until a token starts exactly where
+// the first kept child of the container now starts, or at its closing brace,
+// right after a statement ended. Kept children that a longer token or a new
+// comment ran over, or that continue an unfinished statement, join the
+// region. Returns false if the container's closing brace was run over.
+bool IncrementalParser::lexRegion(size_t regionStart, const PathStep& container, long delta,
+                                  size_t& suffixBegin, std::vector<Token>& fresh) const {
+    const ASTNode& node = *container.node;
+    bool isProgram = container.parent == nullptr;
+    size_t count = node.children.size();
+    auto boundary = [&]() {
+        if (suffixBegin < count) return shifted(container.start + childStart(node, suffixBegin), delta);
+        return isProgram ? source.length() : shifted(container.end - 1, delta);
+    };
+
+    size_t position = regionStart;
+    size_t window = 256;
+    while (true) {
+        size_t length = std::min(window, source.length() - position);
+        bool reachesEnd = position + length == source.length();
+        Lexer lexer(source.substr(position, length));
+        size_t safeEnd = position;
+
+        while (true) {
+            Token token = lexer.nextToken();
+            if (token.type == TokenType::EndOfFile) {
+                if (!reachesEnd) break;
+                suffixBegin = count;
+                return isProgram;
+            }
+            token.start += position;
+            token.end += position;
+
+            // A token touching the window edge may continue past it.
+            if (!reachesEnd && token.end == position + length) break;
+
+            size_t next = boundary();
+            while (next < token.end && next != token.start) {
+                if (suffixBegin == count) return false;
+                suffixBegin++;
+                next = boundary();
+            }
+            if (next == token.start) {
+                if (suffixBegin == count || fresh.empty() || endsStatement(fresh.back())) return true;
+                suffixBegin++;
+            }
+
+            fresh.push_back(token);
+            safeEnd = token.end;
+        }
+
+        position = safeEnd;
+        window *= 2;
+    }
+}
+
+// Span of node.children[index] relative to node, with any pending shift applied.
+size_t IncrementalParser::childStart(const ASTNode& node, size_t index) const {
+    const ASTNode& child = *node.children[index];
+    if (!hasSpan(child)) return 0;
+    auto shift = pendingShifts.find(&node);
+    bool pending = shift != pendingShifts.end() && index >= shift->second.from;
+    return pending ? shifted(child.start, shift->second.delta) : child.start;
+}
+
+size_t IncrementalParser::childEnd(const ASTNode& node, size_t index) const {
+    const ASTNode& child = *node.children[index];
+    if (!hasSpan(child)) return 0;
+    auto shift = pendingShifts.find(&node);
+    bool pending = shift != pendingShifts.end() && index >= shift->second.from;
+    return pending ? shifted(child.end, shift->second.delta) : child.end;
+}
+
+// Slides the start of node's pending shift to `from`, applying it to (or
+// taking it back from) the children in between.
+void IncrementalParser::moveShift(ASTNode& node, size_t from) {
+    auto shift = pendingShifts.find(&node);
+    if (shift == pendingShifts.end()) return;
+
+    PendingShift& pending = shift->second;
+    for (size_t i = pending.from; i < from; ++i) {
+        moveSpan(*node.children[i], pending.delta);
+    }
+    for (size_t i = from; i < pending.from; ++i) {
+        moveSpan(*node.children[i], -pending.delta);
+    }
+    pending.from = from;
+}
+
+void IncrementalParser::shiftAfter(ASTNode& node, size_t from, long delta) {
+    if (delta == 0) return;
+    moveShift(node, from);
+    auto shift = pendingShifts.emplace(&node, PendingShift { from, 0 }).first;
+    shift->second.delta += delta;
+    if (shift->second.delta == 0) pendingShifts.erase(shift);
+}
+
+// Counts the nodes of a subtree that leaves the tree and forgets their shifts.
+size_t IncrementalParser::releaseNodes(const std::shared_ptr<ASTNode>& node) {
+    size_t count = 0;
+    std::vector<const ASTNode*> pending { node.get() };
+    while (!pending.empty()) {
+        const ASTNode* current = pending.back();
+        pending.pop_back();
+        count++;
+        if (!pendingShifts.empty()) pendingShifts.erase(current);
+        for (const auto& child : current->children) {
+            pending.push_back(child.get());
+        }
+    }
+    return count;
+}
+
+// Turns the absolute spans the parser produced into spans relative to the
+// nearest enclosing node that has one; node itself becomes relative to parentStart.
+void IncrementalParser::makeRelative(const std::shared_ptr<ASTNode>& node, size_t parentStart) {
+    std::vector<std::pair<ASTNode*, size_t>> pending { { node.get(), parentStart } };
+    while (!pending.empty()) {
+        ASTNode* current = pending.back().first;
+        size_t base = pending.back().second;
+        pending.pop_back();
+
+        size_t childBase = base;
+        if (hasSpan(*current)) {
+            childBase = current->start;
+            current->start -= base;
+            current->end -= base;
+        }
+        for (const auto& child : current->children) {
+            pending.push_back({ child.get(), childBase });
+        }
+    }
+}
+
+size_t IncrementalParser::countNodes(const std::shared_ptr<ASTNode>& node) {
+    size_t count = 0;
+    std::vector<const ASTNode*> pending { node.get() };
+    while (!pending.empty()) {
+        const ASTNode* current = pending.back();
+        pending.pop_back();
+        count++;
+        for (const auto& child : current->children) {
+            pending.push_back(child.get());
+        }
+    }
+    return count;
+}
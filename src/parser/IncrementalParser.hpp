@@ -0,0 +1,71 @@
+#ifndef INCREMENTAL_PARSER_HPP
+#define INCREMENTAL_PARSER_HPP
+
+#include "Parser.hpp"
+#include "TextBuffer.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct IncrementalStats {
+    size_t relexedTokens = 0;
+    size_t reusedNodes = 0;
+    size_t rebuiltNodes = 0;
+};
+
+// Keeps the AST of a source buffer and updates it after text edits. Only the
+// statements overlapping an edit inside the innermost enclosing Block (or the
+// Program) are re-lexed and re-parsed; every other subtree is kept as is.
+//
+// Spans are stored relative to the start of the parent node, so an edit only
+// touches the nodes on the path down to it. The siblings after that path are
+// moved lazily: each node keeps one pending shift for its trailing children,
+// which the next edit in the same node slides along, so the cost of an edit
+// depends on its distance to the previous one and not on the file size.
+class IncrementalParser {
+public:
+    explicit IncrementalParser(const std::string& source);
+
+    IncrementalStats applyEdit(size_t offset, size_t removedLength, const std::string& insertedText);
+
+    // Spans of the returned tree are relative to the parent's start (the
+    // Program's are absolute). Applies whatever shifts are still pending.
+    const std::shared_ptr<ASTNode>& tree();
+    std::string text() const { return source.str(); }
+
+private:
+    // children[from..] of a node still have to move by delta.
+    struct PendingShift {
+        size_t from;
+        long delta;
+    };
+
+    struct PathStep {
+        ASTNode* node;
+        ASTNode* parent;
+        size_t index; // position in parent->children
+        size_t start; // absolute, before the edit
+        size_t end;
+    };
+
+    TextBuffer source;
+    std::shared_ptr<ASTNode> root;
+    std::unordered_map<const ASTNode*, PendingShift> pendingShifts;
+    size_t nodeCount = 0;
+    bool treeValid = false;
+
+    size_t reparseAll();
+    std::vector<PathStep> findPath(size_t offset, size_t removedEnd) const;
+    bool lexRegion(size_t regionStart, const PathStep& container, long delta,
+                   size_t& suffixBegin, std::vector<Token>& fresh) const;
+    size_t childStart(const ASTNode& node, size_t index) const;
+    size_t childEnd(const ASTNode& node, size_t index) const;
+    void moveShift(ASTNode& node, size_t from);
+    void shiftAfter(ASTNode& node, size_t from, long delta);
+    size_t releaseNodes(const std::shared_ptr<ASTNode>& node);
+    static void makeRelative(const std::shared_ptr<ASTNode>& node, size_t parentStart);
+    static size_t countNodes(const std::shared_ptr<ASTNode>& node);
+};
+
+#endif
@@ -5,12 +5,32 @@
 #include <vector>
 #include <utility>
 
-Parser::Parser(Lexer& lexer) : lexer(lexer) {
+Parser::Parser(Lexer& lexer) : lexer(&lexer) {
+    advance();
+}
+
+Parser::Parser(const std::vector<Token>& tokens, size_t begin, size_t end)
+    : tokens(&tokens), tokenIndex(begin), tokenEnd(end) {
     advance();
 }
 
 void Parser::advance() {
-    currentToken = lexer.nextToken();
+    previousTokenEnd = currentToken.end;
+    if (tokens) {
+        if (tokenIndex < tokenEnd) {
+            currentToken = (*tokens)[tokenIndex++];
+        } else {
+            currentToken = { TokenType::EndOfFile, "", previousTokenEnd, previousTokenEnd };
+        }
+        return;
+    }
+    currentToken = lexer->nextToken();
+}
+
+std::shared_ptr<ASTNode> Parser::finishNode(const std::shared_ptr<ASTNode>& node, size_t start) {
+    node->start = start;
+    node->end = previousTokenEnd;
+    return node;
 }
 
 void Parser::expect(TokenType type, const std::string& errorMessage) {
@@ -35,63 +55,86 @@ void Parser::expectKeyword(const std::string& keyword, const std::string& errorM
     advance();
 }
 
-std::shared_ptr<ASTNode> Parser::parsePrimary() {
-    if (currentToken.type == TokenType::Number) {
-        auto node = std::make_shared<ASTNode>("Number", currentToken.value);
-        advance();
-        return node;
-    }
-
-    if (currentToken.type == TokenType::String) {
-        auto node = std::make_shared<ASTNode>("String", currentToken.value);
-        advance();
-        return node;
-    }
-
-    if (currentToken.type == TokenType::Identifier) {
-        std::string name = currentToken.value;
-        advance();
-
-        if (currentToken.value == "(") {
+// Expressions are parsed with an explicit stack of open groups (the outermost
+// expression, parenthesized sub-expressions and call arguments), so neither
+// long operator chains nor deep nesting grow the native call stack.
+std::shared_ptr<ASTNode> Parser::parseExpression() {
+    struct Group {
+        std::shared_ptr<ASTNode> left;
+        std::string op;
+        std::shared_ptr<ASTNode> call;
+    };
+    std::vector<Group> groups(1);
+
+    while (true) {
+        std::shared_ptr<ASTNode> operand;
+
+        if (currentToken.type == TokenType::Number) {
+            operand = std::make_shared<ASTNode>("Number", currentToken.value);
             advance();
-            auto callNode = std::make_shared<ASTNode>("FunctionCall", name);
-            if (currentToken.value != ")") {
-                while (true) {
-                    callNode->children.push_back(parseExpression());
-                    if (currentToken.value == ")") break;
-                    expectSymbol(",", "Expected ',' between function arguments");
+        } else if (currentToken.type == TokenType::String) {
+            operand = std::make_shared<ASTNode>("String", currentToken.value);
+            advance();
+        } else if (currentToken.type == TokenType::Identifier) {
+            std::string name = currentToken.value;
+            advance();
+
+            if (currentToken.value == "(") {
+                advance();
+                auto callNode = std::make_shared<ASTNode>("FunctionCall", name);
+                if (currentToken.value != ")") {
+                    groups.push_back({ nullptr, "", callNode });
+                    continue;
                 }
+                expectSymbol(")", "Expected ')' after function call arguments");
+                operand = callNode;
+            } else {
+                operand = std::make_shared<ASTNode>("Variable", name);
             }
-            expectSymbol(")", "Expected ')' after function call arguments");
-            return callNode;
+        } else if (currentToken.value == "(") {
+            advance();
+            groups.push_back({});
+            continue;
         } else {
-            return std::make_shared<ASTNode>("Variable", name);
+            throw std::runtime_error("Unexpected token " + currentToken.value + " when expecting start of an expression");
         }
-    }
 
-    if (currentToken.value == "(") {
-        advance();
-        auto node = parseExpression();
-        expectSymbol(")", "Expected ')' after parenthesized expression");
-        return node;
-    }
+        // Fold the operand into its group and close every group it completes.
+        while (true) {
+            Group& group = groups.back();
+            if (group.left) {
+                auto node = std::make_shared<ASTNode>("BinaryOp", group.op);
+                node->children.push_back(group.left);
+                node->children.push_back(operand);
+                group.left = node;
+            } else {
+                group.left = operand;
+            }
 
-    throw std::runtime_error("Unexpected token " + currentToken.value + " when expecting start of an expression");
-}
+            if (currentToken.type == TokenType::Operator) {
+                group.op = currentToken.value;
+                advance();
+                break;
+            }
 
-std::shared_ptr<ASTNode> Parser::parseExpression() {
-    auto left = parsePrimary();
+            if (groups.size() == 1) return group.left;
 
-    while (currentToken.type == TokenType::Operator) {
-        std::string op = currentToken.value;
-        advance();
-        auto right = parsePrimary();
-        auto node = std::make_shared<ASTNode>("BinaryOp", op);
-        node->children.push_back(left);
-        node->children.push_back(right);
-        left = node;
+            if (group.call) {
+                group.call->children.push_back(group.left);
+                if (currentToken.value != ")") {
+                    expectSymbol(",", "Expected ',' between function arguments");
+                    group.left = nullptr;
+                    break;
+                }
+                expectSymbol(")", "Expected ')' after function call arguments");
+                operand = group.call;
+            } else {
+                expectSymbol(")", "Expected ')' after parenthesized expression");
+                operand = group.left;
+            }
+            groups.pop_back();
+        }
     }
-    return left;
 }
 
 std::shared_ptr<ASTNode> Parser::parseDeclaration() {
@@ -104,7 +147,7 @@ std::shared_ptr<ASTNode> Parser::parseDeclaration() {
     advance();
     expectSymbol(":", "Expected ':' after variable name");
 
-    if (currentToken.type != TokenType::Identifier && currentToken.type != TokenType::Keyword) {
+    if (!isTypeName()) {
         throw std::runtime_error("Expected variable type | Token atual: " + currentToken.value);
     }
     std::string varType = currentToken.value;
@@ -154,20 +197,80 @@ std::shared_ptr<ASTNode> Parser::parseAssignmentOrFunctionCallStatement() {
     }
 }
 
+// Parses a block-opening statement ('{', 'func' or 'for') and everything
+// nested in it. Open blocks live on an explicit stack instead of the native
+// call stack, so nesting depth is limited only by memory.
 std::shared_ptr<ASTNode> Parser::parseBlock() {
-    expectSymbol("{", "Expected '{' to start a block");
-    auto node = std::make_shared<ASTNode>("Block", "");
-    while (currentToken.value != "}") {
+    std::vector<OpenBlock> open;
+    auto statement = openBlock(open);
+
+    while (!open.empty()) {
+        if (currentToken.value == "}") {
+            OpenBlock closed = open.back();
+            open.pop_back();
+            expectSymbol("}", "Expected '}' to end a block");
+            finishNode(closed.block, closed.blockStart);
+            if (closed.owner) finishNode(closed.owner, closed.ownerStart);
+            continue;
+        }
         if (currentToken.type == TokenType::EndOfFile) {
             throw std::runtime_error("Unexpected end of file within block, missing '}'");
         }
-        node->children.push_back(parseStatement());
+
+        auto block = open.back().block;
+        if (opensBlock()) {
+            block->children.push_back(openBlock(open));
+        } else {
+            block->children.push_back(parseStatement());
+        }
     }
-    expectSymbol("}", "Expected '}' to end a block");
-    return node;
+    return statement;
+}
+
+// Type names are the builtin type keywords or a plain identifier.
+bool Parser::isTypeName() const {
+    switch (currentToken.type) {
+    case TokenType::Integer:
+    case TokenType::Float:
+    case TokenType::Boolean:
+    case TokenType::Char:
+    case TokenType::Identifier:
+        return true;
+    case TokenType::Keyword:
+        return currentToken.value == "string";
+    default:
+        return false;
+    }
+}
+
+bool Parser::opensBlock() const {
+    if (currentToken.type == TokenType::Keyword) {
+        return currentToken.value == "func" || currentToken.value == "for";
+    }
+    return currentToken.value == "{";
+}
+
+// Parses the header of a function or for loop (if any) and the '{' of its
+// body, then pushes the new block. Returns the statement node it belongs to.
+std::shared_ptr<ASTNode> Parser::openBlock(std::vector<OpenBlock>& open) {
+    size_t ownerStart = currentToken.start;
+    std::shared_ptr<ASTNode> owner;
+    if (currentToken.type == TokenType::Keyword && currentToken.value == "func") {
+        owner = parseFunctionHeader();
+    } else if (currentToken.type == TokenType::Keyword && currentToken.value == "for") {
+        owner = parseForHeader();
+    }
+
+    size_t blockStart = currentToken.start;
+    expectSymbol("{", "Expected '{' to start a block");
+    auto block = std::make_shared<ASTNode>("Block", "");
+    if (owner) owner->children.push_back(block);
+
+    open.push_back({ block, owner, blockStart, ownerStart });
+    return owner ? owner : block;
 }
 
-std::shared_ptr<ASTNode> Parser::parseFunction() {
+std::shared_ptr<ASTNode> Parser::parseFunctionHeader() {
     expectKeyword("func", "Expected 'func' keyword");
 
     if (currentToken.type != TokenType::Identifier) {
@@ -189,7 +292,7 @@ std::shared_ptr<ASTNode> Parser::parseFunction() {
 
             expectSymbol(":", "Expected ':' after parameter name");
 
-            if (currentToken.type != TokenType::Identifier && currentToken.type != TokenType::Keyword) {
+            if (!isTypeName()) {
                 throw std::runtime_error("Expected parameter type | Token atual: " + currentToken.value);
             }
             std::string paramType = currentToken.value;
@@ -204,20 +307,17 @@ std::shared_ptr<ASTNode> Parser::parseFunction() {
     expectSymbol(")", "Expected ')' after parameter list");
     expectSymbol(":", "Expected ':' before return type");
 
-    if (currentToken.type != TokenType::Identifier && currentToken.type != TokenType::Keyword) {
+    if (!isTypeName()) {
         throw std::runtime_error("Expected return type | Token atual: " + currentToken.value);
     }
     std::string returnType = currentToken.value;
     advance();
 
-    auto body = parseBlock();
-
     auto node = std::make_shared<ASTNode>("Function", functionName + ":" + returnType);
     for (const auto& param : parameters) {
         auto paramNode = std::make_shared<ASTNode>("Parameter", param.first + ":" + param.second);
         node->children.push_back(paramNode);
     }
-    node->children.push_back(body);
     return node;
 }
 
@@ -233,7 +333,33 @@ std::shared_ptr<ASTNode> Parser::parseReturnStatement() {
     return node;
 }
 
-std::shared_ptr<ASTNode> Parser::parseForStatement() {
+std::shared_ptr<ASTNode> Parser::parsePrintStatement() {
+    expectKeyword("print", "Expected 'print' keyword");
+    expectSymbol("(", "Expected '(' after 'print'");
+    auto node = std::make_shared<ASTNode>("Print", "");
+    node->children.push_back(parseExpression());
+    expectSymbol(")", "Expected ')' after print argument");
+    expectSymbol(";", "Expected ';' after print statement");
+    return node;
+}
+
+std::shared_ptr<ASTNode> Parser::parseInputStatement() {
+    expectKeyword("input", "Expected 'input' keyword");
+    expectSymbol("(", "Expected '(' after 'input'");
+    if (currentToken.type != TokenType::Identifier) {
+        throw std::runtime_error("Expected variable name in input | Token atual: " + currentToken.value);
+    }
+    auto node = std::make_shared<ASTNode>("Input", "");
+    node->children.push_back(std::make_shared<ASTNode>("Variable", currentToken.value));
+    advance();
+    expectSymbol(")", "Expected ')' after input variable");
+    expectSymbol(";", "Expected ';' after input statement");
+    return node;
+}
+
+// Always produces the three clauses (an Empty node for an omitted one), so
+// the body Block is the fourth child.
+std::shared_ptr<ASTNode> Parser::parseForHeader() {
     expectKeyword("for", "Expected 'for' keyword");
     expectSymbol("(", "Expected '(' after 'for'");
 
@@ -252,11 +378,14 @@ std::shared_ptr<ASTNode> Parser::parseForStatement() {
         node->children.push_back(initAssign);
         expectSymbol(";", "Expected ';' after for loop initializer");
     } else {
+        node->children.push_back(std::make_shared<ASTNode>("Empty", ""));
         expectSymbol(";", "Expected ';' after empty initializer");
     }
 
     if (currentToken.value != ";") {
         node->children.push_back(parseExpression());
+    } else {
+        node->children.push_back(std::make_shared<ASTNode>("Empty", ""));
     }
     expectSymbol(";", "Expected ';' after for loop condition");
 
@@ -273,32 +402,39 @@ std::shared_ptr<ASTNode> Parser::parseForStatement() {
         } else {
             throw std::runtime_error("Expected assignment in for loop increment | Token atual: " + currentToken.value);
         }
+    } else {
+        node->children.push_back(std::make_shared<ASTNode>("Empty", ""));
     }
     expectSymbol(")", "Expected ')' after for loop clauses");
 
-    node->children.push_back(parseBlock());
-
     return node;
 }
 
 std::shared_ptr<ASTNode> Parser::parse() {
+    size_t start = currentToken.start;
     auto root = std::make_shared<ASTNode>("Program", "");
-    while (currentToken.type != TokenType::EndOfFile) {
-        root->children.push_back(parseStatement());
+    while (auto statement = parseNext()) {
+        root->children.push_back(statement);
     }
-    return root;
+    return finishNode(root, start);
+}
+
+std::shared_ptr<ASTNode> Parser::parseNext() {
+    if (currentToken.type == TokenType::EndOfFile) return nullptr;
+    return parseStatement();
 }
 
 std::shared_ptr<ASTNode> Parser::parseStatement() {
+    if (opensBlock()) return parseBlock();
+
+    size_t start = currentToken.start;
     if (currentToken.type == TokenType::Keyword) {
-        if (currentToken.value == "var") return parseDeclaration();
-        if (currentToken.value == "func") return parseFunction();
-        if (currentToken.value == "return") return parseReturnStatement();
-        if (currentToken.value == "for") return parseForStatement();
+        if (currentToken.value == "var") return finishNode(parseDeclaration(), start);
+        if (currentToken.value == "return") return finishNode(parseReturnStatement(), start);
+        if (currentToken.value == "print") return finishNode(parsePrintStatement(), start);
+        if (currentToken.value == "input") return finishNode(parseInputStatement(), start);
     } else if (currentToken.type == TokenType::Identifier) {
-        return parseAssignmentOrFunctionCallStatement();
-    } else if (currentToken.value == "{") {
-        return parseBlock();
+        return finishNode(parseAssignmentOrFunctionCallStatement(), start);
     }
 
     throw std::runtime_error("Unexpected token '" + currentToken.value + "' at start of statement");
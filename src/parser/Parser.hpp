@@ -11,26 +11,46 @@
 class Parser {
 public:
     Parser(Lexer& lexer);
+    // Parses tokens[begin, end) of an already lexed stream instead of pulling from a Lexer.
+    Parser(const std::vector<Token>& tokens, size_t begin, size_t end);
     std::shared_ptr<ASTNode> parse();
+    // Returns the next top-level statement, or nullptr once the input is exhausted.
+    std::shared_ptr<ASTNode> parseNext();
 
 private:
     Token currentToken;
-    Lexer& lexer;
+    Lexer* lexer = nullptr;
+    const std::vector<Token>* tokens = nullptr;
+    size_t tokenIndex = 0;
+    size_t tokenEnd = 0;
+    size_t previousTokenEnd = 0;
 
     void advance();
+    std::shared_ptr<ASTNode> finishNode(const std::shared_ptr<ASTNode>& node, size_t start);
     void expect(TokenType type, const std::string& errorMessage);
     void expectSymbol(const std::string& symbol, const std::string& errorMessage);
     void expectKeyword(const std::string& keyword, const std::string& errorMessage);
 
+    struct OpenBlock {
+        std::shared_ptr<ASTNode> block;
+        std::shared_ptr<ASTNode> owner; // Function or ForLoop the block is the body of
+        size_t blockStart;
+        size_t ownerStart;
+    };
+
     std::shared_ptr<ASTNode> parseBlock();
+    bool opensBlock() const;
+    bool isTypeName() const;
+    std::shared_ptr<ASTNode> openBlock(std::vector<OpenBlock>& open);
     std::shared_ptr<ASTNode> parseStatement();
     std::shared_ptr<ASTNode> parseDeclaration();
-    std::shared_ptr<ASTNode> parseForStatement(); 
-    std::shared_ptr<ASTNode> parseFunction();
+    std::shared_ptr<ASTNode> parseForHeader(); 
+    std::shared_ptr<ASTNode> parseFunctionHeader();
     std::shared_ptr<ASTNode> parseReturnStatement(); 
+    std::shared_ptr<ASTNode> parsePrintStatement();
+    std::shared_ptr<ASTNode> parseInputStatement();
     std::shared_ptr<ASTNode> parseAssignmentOrFunctionCallStatement(); 
 
-    std::shared_ptr<ASTNode> parsePrimary();
     std::shared_ptr<ASTNode> parseExpression();
     std::shared_ptr<ASTNode> parseAssignment();
 };
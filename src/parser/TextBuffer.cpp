@@ -0,0 +1,48 @@
+#include "TextBuffer.hpp"
+#include <algorithm>
+
+TextBuffer::TextBuffer(const std::string& text)
+    : buffer(text), gapStart(text.size()), gapEnd(text.size()) {}
+
+void TextBuffer::replace(size_t offset, size_t removedLength, const std::string& insertedText) {
+    moveGap(offset);
+    gapEnd += removedLength;
+
+    if (insertedText.size() > gapEnd - gapStart) {
+        // Grow by a fraction of the text so refills stay rare.
+        size_t gap = insertedText.size() + std::max(MinimumGap, length() / 4);
+        size_t tail = buffer.size() - gapEnd;
+        buffer.resize(gapStart + gap + tail);
+        std::copy_backward(buffer.begin() + gapEnd, buffer.begin() + gapEnd + tail, buffer.end());
+        gapEnd = gapStart + gap;
+    }
+
+    std::copy(insertedText.begin(), insertedText.end(), buffer.begin() + gapStart);
+    gapStart += insertedText.size();
+}
+
+std::string TextBuffer::substr(size_t position, size_t count) const {
+    count = std::min(count, length() - position);
+    std::string text;
+    text.reserve(count);
+    if (position < gapStart) {
+        size_t before = std::min(count, gapStart - position);
+        text.append(buffer, position, before);
+        position += before;
+        count -= before;
+    }
+    text.append(buffer, position + (gapEnd - gapStart), count);
+    return text;
+}
+
+void TextBuffer::moveGap(size_t offset) {
+    if (offset < gapStart) {
+        std::copy_backward(buffer.begin() + offset, buffer.begin() + gapStart, buffer.begin() + gapEnd);
+        gapEnd -= gapStart - offset;
+        gapStart = offset;
+    } else if (offset > gapStart) {
+        std::copy(buffer.begin() + gapEnd, buffer.begin() + gapEnd + (offset - gapStart), buffer.begin() + gapStart);
+        gapEnd += offset - gapStart;
+        gapStart = offset;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef TEXT_BUFFER_HPP
+#define TEXT_BUFFER_HPP
+
+#include <string>
+
+// Editable text kept as a gap buffer: the unused space sits at the last edit,
+// so a run of edits in one place only moves the text between them instead of
+// everything that follows.
+class TextBuffer {
+public:
+    explicit TextBuffer(const std::string& text);
+
+    size_t length() const { return buffer.size() - (gapEnd - gapStart); }
+    void replace(size_t offset, size_t removedLength, const std::string& insertedText);
+    std::string substr(size_t position, size_t count) const;
+    std::string str() const { return substr(0, length()); }
+
+private:
+    static constexpr size_t MinimumGap = 4096;
+
+    std::string buffer;
+    size_t gapStart;
+    size_t gapEnd;
+
+    void moveGap(size_t offset);
+};
+
+#endif
@@ -1,74 +1,340 @@
 #include "SemanticAnalyzer.hpp"
+#include <algorithm>
 #include <iostream>
 
 SemanticAnalyzer::SemanticAnalyzer() {}
 
 void SemanticAnalyzer::analyze(const std::shared_ptr<ASTNode>& root) {
-    analyzeNode(root);
+    walk(root, *this);
 }
 
-void SemanticAnalyzer::analyzeNode(const std::shared_ptr<ASTNode>& node) {
-    if (node->nodeType == "Program" || node->nodeType == "Block") {
-        symbolTable.enterScope();
-        for (const auto& child : node->children) {
-            analyzeNode(child);
+void SemanticAnalyzer::analyzeStatement(const std::shared_ptr<ASTNode>& statement) {
+    walk(statement, *this);
+}
+
+void SemanticAnalyzer::finish() {
+    std::vector<std::string> names;
+    for (const auto& entry : deferredCalls) names.push_back(entry.first);
+    std::sort(names.begin(), names.end());
+    for (const auto& name : names) {
+        for (size_t i = 0; i < deferredCalls[name].size(); ++i) {
+            error("função '" + name + "' não declarada.");
         }
-        symbolTable.exitScope();
     }
-    else if (node->nodeType == "Declaration") {
-        auto parts = node->value.find(':');
-        std::string varName = node->value.substr(0, parts);
-        std::string varType = node->value.substr(parts + 1);
-        
-        if (!symbolTable.declare(varName, varType)) {
-            std::cerr << "Erro: variável '" << varName << "' já declarada neste escopo.\n";
-        }
+    deferredCalls.clear();
+}
+
+void SemanticAnalyzer::error(const std::string& message) {
+    std::cerr << "Erro: " << message << "\n";
+    errors++;
+}
+
+TypeId SemanticAnalyzer::resolveType(const std::string& name) {
+    TypeId type = types.lookup(name);
+    if (type == Types::Error) {
+        error("tipo '" + name + "' desconhecido.");
     }
-    else if (node->nodeType == "Param") {
-        auto parts = node->value.find(':');
-        std::string paramName = node->value.substr(0, parts);
-        std::string paramType = node->value.substr(parts + 1);
-        symbolTable.declare(paramName, paramType);
+    return type;
+}
+
+// With `ahead` the function is only announced (the Program does this for its
+// top-level functions); a duplicate is reported once its definition is reached.
+void SemanticAnalyzer::declareFunction(const ASTNode& function, bool ahead) {
+    FunctionSignature* existing = symbolTable.findFunction(function.name);
+    if (existing) {
+        if (ahead) return;
+        if (existing->predeclared) {
+            existing->predeclared = false;
+        } else {
+            error("função '" + function.name + "' já declarada.");
+        }
+        return;
     }
-    else if (node->nodeType == "Expression") {
-        std::string varName = node->value;
-        if (!symbolTable.isDeclared(varName)) {
-            std::cerr << "Erro: variável '" << varName << "' não declarada.\n";
+
+    FunctionSignature signature { resolveType(function.typeName), {}, ahead };
+    for (const auto& child : function.children) {
+        if (child->kind == NodeKind::Param) {
+            signature.parameters.push_back(resolveType(child->typeName));
         }
     }
-    else if (node->nodeType == "If" || node->nodeType == "While") {
-        for (const auto& child : node->children) {
-            analyzeNode(child);
+    symbolTable.declareFunction(function.name, signature);
+
+    auto deferred = deferredCalls.find(function.name);
+    if (deferred == deferredCalls.end()) return;
+    for (const auto& call : deferred->second) {
+        checkDeferred(function.name, call, signature);
+    }
+    deferredCalls.erase(deferred);
+}
+
+void SemanticAnalyzer::checkCondition(const ASTNode& condition, const std::string& statement) {
+    if (condition.kind == NodeKind::Empty) return;
+    if (condition.type != Types::Bool && condition.type != Types::Error) {
+        error("condição do " + statement + " deve ser bool, não '" + types.name(condition.type) + "'.");
+    }
+}
+
+void SemanticAnalyzer::checkCall(ASTNode& call) {
+    const FunctionSignature* signature = symbolTable.findFunction(call.value);
+    if (!signature && !wholeProgram) {
+        deferCall(call);
+        return;
+    }
+    if (!signature) {
+        error("função '" + call.value + "' não declarada.");
+        call.type = Types::Error;
+        return;
+    }
+
+    call.type = signature->returnType;
+    if (call.children.size() != signature->parameters.size()) {
+        error("função '" + call.value + "' espera " + std::to_string(signature->parameters.size()) +
+              " argumento(s), recebeu " + std::to_string(call.children.size()) + ".");
+        return;
+    }
+
+    for (size_t i = 0; i < call.children.size(); ++i) {
+        assume(*call.children[i], signature->parameters[i]);
+        TypeId argument = call.children[i]->type;
+        TypeId parameter = signature->parameters[i];
+        if (argument == Types::Error || parameter == Types::Error) continue;
+        if (!TypeTable::isAssignable(parameter, argument)) {
+            error("argumento " + std::to_string(i + 1) + " de '" + call.value + "' deve ser '" +
+                  types.name(parameter) + "', não '" + types.name(argument) + "'.");
         }
     }
-    else if (node->nodeType == "For") {
-        symbolTable.enterScope();
+}
 
-        analyzeNode(node->children[0]); 
-        analyzeNode(node->children[1]); 
-        analyzeNode(node->children[2]); 
-        analyzeNode(node->children[3]); 
+// Without a whole program there is nothing to look ahead in, so a call may
+// reach its function first. It is compiled as returning int (nothing, as a
+// statement) unless its context expects another type, and its arguments as
+// they are typed.
+void SemanticAnalyzer::deferCall(ASTNode& call) {
+    DeferredCall deferred { {}, call.kind == NodeKind::FunctionCallStatement ? Types::Void : Types::Int };
+    for (const auto& argument : call.children) {
+        deferred.arguments.push_back(argument->type);
+    }
 
-        symbolTable.exitScope();
+    std::vector<DeferredCall>& calls = deferredCalls[call.value];
+    unresolvedCalls[&call] = { call.value, calls.size() };
+    calls.push_back(deferred);
+    call.type = deferred.assumed;
+}
+
+// Types a deferred call with what its context expects.
+void SemanticAnalyzer::assume(ASTNode& value, TypeId type) {
+    auto it = unresolvedCalls.find(&value);
+    if (it == unresolvedCalls.end() || type == Types::Error) return;
+
+    auto deferred = deferredCalls.find(it->second.first);
+    if (deferred != deferredCalls.end() && it->second.second < deferred->second.size()) {
+        deferred->second[it->second.second].assumed = type;
+        value.type = type;
     }
-    else if (node->nodeType == "Function") {
-        symbolTable.enterScope();
+    unresolvedCalls.erase(it);
+}
 
-        for (const auto& child : node->children) {
-            if (child->nodeType == "Param") {
-                auto split = child->value.find(':');
-                std::string name = child->value.substr(0, split);
-                std::string type = child->value.substr(split + 1);
-                symbolTable.declare(name, type);
-            }
+// The call has already been compiled, so on top of the usual checks its
+// floats must sit where the definition expects them: a float is passed and
+// returned apart from every other type.
+void SemanticAnalyzer::checkDeferred(const std::string& name, const DeferredCall& call,
+                                     const FunctionSignature& signature) {
+    if (call.arguments.size() != signature.parameters.size()) {
+        error("função '" + name + "' espera " + std::to_string(signature.parameters.size()) +
+              " argumento(s), recebeu " + std::to_string(call.arguments.size()) + ".");
+        return;
+    }
+
+    for (size_t i = 0; i < call.arguments.size(); ++i) {
+        TypeId argument = call.arguments[i];
+        TypeId parameter = signature.parameters[i];
+        if (argument == Types::Error || parameter == Types::Error) continue;
+        if (!TypeTable::isAssignable(parameter, argument) || (parameter == Types::Float) != (argument == Types::Float)) {
+            error("argumento " + std::to_string(i + 1) + " de '" + name + "' deve ser '" +
+                  types.name(parameter) + "', não '" + types.name(argument) + "', numa chamada anterior à definição.");
         }
+    }
 
-        for (const auto& child : node->children) {
-            if (child->nodeType != "Param") {
-                analyzeNode(child);
-            }
+    TypeId result = signature.returnType;
+    if (result == Types::Error) return;
+    if (call.assumed == Types::Void) {
+        if (result == Types::Float) {
+            error("o resultado float de '" + name + "' não pode ser descartado numa chamada anterior à definição.");
         }
+    } else if (!TypeTable::isAssignable(call.assumed, result) || (call.assumed == Types::Float) != (result == Types::Float)) {
+        error("função '" + name + "' foi usada como '" + types.name(call.assumed) +
+              "' antes de sua definição, mas retorna '" + types.name(result) + "'.");
+    }
+}
+
+TypeId SemanticAnalyzer::binaryType(const ASTNode& node) {
+    TypeId left = node.children[0]->type;
+    TypeId right = node.children[1]->type;
+    if (left == Types::Error || right == Types::Error) return Types::Error;
+
+    const std::string& op = node.value;
+    bool numeric = TypeTable::isNumeric(left) && TypeTable::isNumeric(right);
+    TypeId promoted = (left == Types::Float || right == Types::Float) ? Types::Float : Types::Int;
 
+    if (op == "+" && (left == Types::String || right == Types::String)) {
+        if (left != Types::Void && right != Types::Void) return Types::String;
+    }
+    else if (op == "+" || op == "-" || op == "*" || op == "/") {
+        if (numeric) return promoted;
+    }
+    else if (op == "<" || op == ">" || op == "<=" || op == ">=") {
+        if (numeric) return Types::Bool;
+    }
+    else if (op == "==" || op == "!=") {
+        if (numeric || (left == right && left != Types::Void)) return Types::Bool;
+    }
+    else if (op == "=") {
+        error("atribuição não pode ser usada como expressão.");
+        return Types::Error;
+    }
+
+    error("operador '" + op + "' não se aplica a '" + types.name(left) + "' e '" + types.name(right) + "'.");
+    return Types::Error;
+}
+
+bool SemanticAnalyzer::enter(ASTNode& node) {
+    depth++;
+    switch (node.kind) {
+    case NodeKind::Program:
+        wholeProgram = true;
+        symbolTable.enterScope();
+        // Top-level functions may be called before their definition.
+        for (const auto& child : node.children) {
+            if (child->kind == NodeKind::Function) declareFunction(*child, true);
+        }
+        break;
+    case NodeKind::Block:
+    case NodeKind::For:
+        symbolTable.enterScope();
+        break;
+    case NodeKind::Function:
+        declareFunction(node, false);
+        returnTypes.push_back(types.lookup(node.typeName));
+        symbolTable.enterScope();
+        functionScopes.push_back(symbolTable.scopeLevel());
+        break;
+    case NodeKind::Param:
+        node.type = resolveType(node.typeName);
+        symbolTable.declare(node.name, node.type);
+        break;
+    case NodeKind::Variable: {
+        const Symbol* symbol = symbolTable.lookup(node.value);
+        if (!symbol) {
+            error("variável '" + node.value + "' não declarada.");
+            node.type = Types::Error;
+        } else if (functionScopes.size() > 1 && symbol->scopeLevel >= functionScopes.front() &&
+                   symbol->scopeLevel < functionScopes.back()) {
+            // A nested function has a frame of its own and can't reach the
+            // locals of the function around it.
+            error("variável '" + node.value + "' pertence a outra função.");
+            node.type = Types::Error;
+        } else {
+            node.type = symbol->type;
+        }
+        break;
+    }
+    case NodeKind::Number:
+        node.type = node.value.find('.') == std::string::npos ? Types::Int : Types::Float;
+        break;
+    case NodeKind::String:
+        node.type = Types::String;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+void SemanticAnalyzer::leave(ASTNode& node) {
+    switch (node.kind) {
+    case NodeKind::Program:
+        wholeProgram = false;
+        symbolTable.exitScope();
+        break;
+    case NodeKind::Block:
+        symbolTable.exitScope();
+        break;
+    case NodeKind::For:
+        checkCondition(*node.children[1], "for");
         symbolTable.exitScope();
+        break;
+    case NodeKind::If:
+    case NodeKind::While:
+        checkCondition(*node.children[0], node.kind == NodeKind::If ? "if" : "while");
+        break;
+    case NodeKind::Function:
+        symbolTable.exitScope();
+        returnTypes.pop_back();
+        functionScopes.pop_back();
+        break;
+    case NodeKind::Declaration:
+        // Declared after its initializer has been checked.
+        node.type = resolveType(node.typeName);
+        if (!node.children.empty()) {
+            assume(*node.children[0], node.type);
+            TypeId value = node.children[0]->type;
+            if (node.type != Types::Error && value != Types::Error && !TypeTable::isAssignable(node.type, value)) {
+                error("não é possível inicializar '" + node.name + "' (" + types.name(node.type) +
+                      ") com '" + types.name(value) + "'.");
+            }
+        }
+        if (!symbolTable.declare(node.name, node.type)) {
+            error("variável '" + node.name + "' já declarada neste escopo.");
+        }
+        break;
+    case NodeKind::Assignment: {
+        assume(*node.children[1], node.children[0]->type);
+        TypeId target = node.children[0]->type;
+        TypeId value = node.children[1]->type;
+        if (target != Types::Error && value != Types::Error && !TypeTable::isAssignable(target, value)) {
+            error("não é possível atribuir '" + types.name(value) + "' a '" + node.children[0]->value +
+                  "' (" + types.name(target) + ").");
+        }
+        node.type = target;
+        break;
     }
+    case NodeKind::BinaryOp:
+        node.type = binaryType(node);
+        break;
+    case NodeKind::FunctionCall:
+    case NodeKind::FunctionCallStatement:
+        checkCall(node);
+        break;
+    case NodeKind::Print:
+        if (node.children[0]->type == Types::Void) {
+            error("print não aceita uma expressão void.");
+        }
+        break;
+    case NodeKind::Input: {
+        TypeId target = node.children[0]->type;
+        if (target != Types::Int && target != Types::Error) {
+            error("input espera uma variável int, não '" + types.name(target) + "'.");
+        }
+        break;
+    }
+    case NodeKind::Return: {
+        if (returnTypes.empty()) {
+            error("return fora de uma função.");
+            break;
+        }
+        TypeId expected = returnTypes.back();
+        if (!node.children.empty()) assume(*node.children[0], expected);
+        TypeId value = node.children.empty() ? Types::Void : node.children[0]->type;
+        if (expected != Types::Error && value != Types::Error && !TypeTable::isAssignable(expected, value)) {
+            error("return deve ser '" + types.name(expected) + "', não '" + types.name(value) + "'.");
+        }
+        node.type = value;
+        break;
+    }
+    default:
+        break;
+    }
+
+    // The calls of a finished statement can no longer be given a type.
+    if (--depth == 0) unresolvedCalls.clear();
 }
@@ -2,18 +2,64 @@
 #define SEMANTIC_ANALYZER_HPP
 
 #include "../parser/Parser.hpp"
+#include "../symbol/ASTVisitor.hpp"
 #include "../symbol/SymbolTable.hpp"
+#include "../symbol/Types.hpp"
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-class SemanticAnalyzer {
+// Scope and type checking. Every expression node gets its TypeId in
+// ASTNode::type; nodes whose operands already failed get Types::Error so a
+// mistake is reported only once.
+class SemanticAnalyzer : public ASTVisitor {
 public:
     SemanticAnalyzer();
     void analyze(const std::shared_ptr<ASTNode>& root);
+    // Checks one top-level statement; declarations stay visible to later calls.
+    // A call may come before its function's definition here: it is typed from
+    // its context and checked once the definition is reached.
+    void analyzeStatement(const std::shared_ptr<ASTNode>& statement);
+    // Ends a program checked statement by statement: calls to functions that
+    // were never defined are reported.
+    void finish();
+
+    size_t errorCount() const { return errors; }
+    const TypeTable& typeTable() const { return types; }
+
+    bool enter(ASTNode& node) override;
+    void leave(ASTNode& node) override;
 
 private:
+    // A call made before its function's definition.
+    struct DeferredCall {
+        std::vector<TypeId> arguments;
+        TypeId assumed; // result type it was compiled with; Void when unused
+    };
+
     SymbolTable symbolTable;
+    TypeTable types;
+    std::vector<TypeId> returnTypes; // of the functions being checked
+    std::vector<int> functionScopes; // scope level of each open function's parameters
+    size_t errors = 0;
+    bool wholeProgram = false;
+    size_t depth = 0; // nodes open in the current walk
+
+    std::unordered_map<std::string, std::vector<DeferredCall>> deferredCalls;
+    // Calls of the current statement that are still deferred, with their entry.
+    std::unordered_map<const ASTNode*, std::pair<std::string, size_t>> unresolvedCalls;
 
-    void analyzeNode(const std::shared_ptr<ASTNode>& node);
+    void error(const std::string& message);
+    TypeId resolveType(const std::string& name);
+    void declareFunction(const ASTNode& function, bool ahead);
+    void checkCondition(const ASTNode& condition, const std::string& statement);
+    void checkCall(ASTNode& call);
+    void deferCall(ASTNode& call);
+    void assume(ASTNode& value, TypeId type);
+    void checkDeferred(const std::string& name, const DeferredCall& call, const FunctionSignature& signature);
+    TypeId binaryType(const ASTNode& node);
 };
 
 #endif
@@ -4,14 +4,100 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include "Types.hpp"
+
+enum class NodeKind {
+    Program,
+    Block,
+    Declaration,
+    Param,
+    Function,
+    Return,
+    Assignment,
+    FunctionCall,
+    FunctionCallStatement,
+    For,
+    If,
+    While,
+    Print,
+    Input,
+    Variable,
+    Number,
+    String,
+    BinaryOp,
+    Empty,
+    Unknown
+};
+
+// Resolved once per node so the passes dispatch on an enum instead of
+// comparing nodeType strings. Older spellings map to the same kind.
+inline NodeKind nodeKindFromType(const std::string& type) {
+    static const std::unordered_map<std::string, NodeKind> kinds = {
+        { "Program", NodeKind::Program },
+        { "Block", NodeKind::Block },
+        { "Declaration", NodeKind::Declaration },
+        { "Parameter", NodeKind::Param },
+        { "Param", NodeKind::Param },
+        { "Function", NodeKind::Function },
+        { "Return", NodeKind::Return },
+        { "Assignment", NodeKind::Assignment },
+        { "FunctionCall", NodeKind::FunctionCall },
+        { "FunctionCallStatement", NodeKind::FunctionCallStatement },
+        { "ForLoop", NodeKind::For },
+        { "For", NodeKind::For },
+        { "If", NodeKind::If },
+        { "While", NodeKind::While },
+        { "Print", NodeKind::Print },
+        { "Input", NodeKind::Input },
+        { "Variable", NodeKind::Variable },
+        { "Expression", NodeKind::Variable },
+        { "Number", NodeKind::Number },
+        { "String", NodeKind::String },
+        { "BinaryOp", NodeKind::BinaryOp },
+        { "Empty", NodeKind::Empty },
+    };
+    auto it = kinds.find(type);
+    return it == kinds.end() ? NodeKind::Unknown : it->second;
+}
 
 struct ASTNode {
     std::string nodeType;            
     std::string value;               
     std::vector<std::shared_ptr<ASTNode>> children; 
+    size_t start = 0;                // source span, set for statements and blocks
+    size_t end = 0;
+
+    NodeKind kind;
+    std::string name;                // "name:type" values split up front
+    std::string typeName;
+    TypeId type = Types::Unknown;    // filled in by the semantic analyzer
 
     ASTNode(const std::string& type, const std::string& val)
-        : nodeType(type), value(val) {{}}
+        : nodeType(type), value(val), kind(nodeKindFromType(type)) {
+        if (kind == NodeKind::Declaration || kind == NodeKind::Param || kind == NodeKind::Function) {
+            auto split = value.find(':');
+            name = value.substr(0, split);
+            if (split != std::string::npos) typeName = value.substr(split + 1);
+        }
+    }
+
+    // Tears the subtree down iteratively: children this node solely owns are
+    // emptied before they are released, so deep trees don't recurse.
+    ~ASTNode() {
+        std::vector<std::shared_ptr<ASTNode>> pending;
+        pending.swap(children);
+        while (!pending.empty()) {
+            std::shared_ptr<ASTNode> node = std::move(pending.back());
+            pending.pop_back();
+            if (node && node.use_count() == 1) {
+                for (auto& child : node->children) {
+                    pending.push_back(std::move(child));
+                }
+                node->children.clear();
+            }
+        }
+    }
 };
 
 #endif 
@@ -0,0 +1,64 @@
+#include "ASTVisitor.hpp"
+#include <vector>
+
+void walk(const std::shared_ptr<ASTNode>& root, ASTVisitor& visitor) {
+    struct Frame {
+        ASTNode* node;
+        size_t next;
+        bool descend;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({ root.get(), 0, visitor.enter(*root) });
+
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        if (top.descend && top.next < top.node->children.size()) {
+            ASTNode* parent = top.node;
+            size_t position = top.next++;
+            visitor.beforeChild(*parent, position);
+            ASTNode* child = parent->children[visitor.childAt(*parent, position)].get();
+            stack.push_back({ child, 0, visitor.enter(*child) });
+        } else {
+            ASTNode* node = top.node;
+            stack.pop_back();
+            visitor.leave(*node);
+        }
+    }
+}
+
+FusedVisitor::FusedVisitor(ASTVisitor& checker, ASTVisitor& emitter)
+    : checker{ checker, 0 }, emitter{ emitter, 0 } {}
+
+void FusedVisitor::enter(Side& side, ASTNode& node) {
+    if (side.muted > 0) {
+        side.muted++;
+    } else if (!side.visitor.enter(node)) {
+        side.muted = 1;
+    }
+}
+
+void FusedVisitor::leave(Side& side, ASTNode& node) {
+    if (side.muted > 0 && --side.muted > 0) return;
+    side.visitor.leave(node);
+}
+
+bool FusedVisitor::enter(ASTNode& node) {
+    enter(checker, node);
+    enter(emitter, node);
+    return checker.muted == 0 || emitter.muted == 0;
+}
+
+void FusedVisitor::leave(ASTNode& node) {
+    leave(checker, node);
+    leave(emitter, node);
+}
+
+void FusedVisitor::beforeChild(ASTNode& node, size_t position) {
+    if (checker.muted == 0) checker.visitor.beforeChild(node, position);
+    if (emitter.muted == 0) emitter.visitor.beforeChild(node, position);
+}
+
+size_t FusedVisitor::childAt(const ASTNode& node, size_t position) const {
+    return emitter.muted == 0 ? emitter.visitor.childAt(node, position)
+                              : checker.visitor.childAt(node, position);
+}
@@ -0,0 +1,54 @@
+#ifndef AST_VISITOR_HPP
+#define AST_VISITOR_HPP
+
+#include "ASTNode.hpp"
+#include <memory>
+
+// Callbacks for walk(). A visitor switches on ASTNode::kind inside each hook.
+class ASTVisitor {
+public:
+    virtual ~ASTVisitor() = default;
+
+    // Called before the children; returning false skips them. leave() is
+    // called either way.
+    virtual bool enter(ASTNode& node) = 0;
+    virtual void leave(ASTNode&) {}
+
+    // Called before the child visited at `position` is entered.
+    virtual void beforeChild(ASTNode&, size_t) {}
+
+    // Index of the child visited at `position`, for visitors that need an
+    // order other than the source order.
+    virtual size_t childAt(const ASTNode&, size_t position) const { return position; }
+};
+
+// Depth-first traversal with an explicit stack.
+void walk(const std::shared_ptr<ASTNode>& root, ASTVisitor& visitor);
+
+// Drives two visitors through a single traversal. Each one sees exactly the
+// events it would see walking alone, except that children are visited in the
+// emitter's order while it is descending.
+class FusedVisitor : public ASTVisitor {
+public:
+    FusedVisitor(ASTVisitor& checker, ASTVisitor& emitter);
+
+    bool enter(ASTNode& node) override;
+    void leave(ASTNode& node) override;
+    void beforeChild(ASTNode& node, size_t position) override;
+    size_t childAt(const ASTNode& node, size_t position) const override;
+
+private:
+    // `muted` counts the open nodes below the one whose children this
+    // visitor declined; it receives no events until that node is left.
+    struct Side {
+        ASTVisitor& visitor;
+        size_t muted;
+    };
+    Side checker;
+    Side emitter;
+
+    static void enter(Side& side, ASTNode& node);
+    static void leave(Side& side, ASTNode& node);
+};
+
+#endif
@@ -2,39 +2,54 @@
 
 void SymbolTable::enterScope() {
     currentScopeLevel++;
+    scopes.emplace_back();
 }
 
 void SymbolTable::exitScope() {
-    symbols.erase(
-        std::remove_if(symbols.begin(), symbols.end(),
-            [this](const Symbol& sym) {
-                return sym.scopeLevel == currentScopeLevel;
-            }),
-        symbols.end()
-    );
+    for (const auto& name : scopes.back()) {
+        auto it = symbols.find(name);
+        it->second.pop_back();
+        if (it->second.empty()) symbols.erase(it);
+    }
+    scopes.back().clear();
+    if (scopes.size() > 1) scopes.pop_back();
     currentScopeLevel--;
 }
 
-bool SymbolTable::declare(const std::string& name, const std::string& type) {
-    for (const auto& sym : symbols) {
-        if (sym.name == name && sym.scopeLevel == currentScopeLevel) {
-            return false;
-        }
+bool SymbolTable::declare(const std::string& name, TypeId type) {
+    std::vector<Symbol>& declarations = symbols[name];
+    if (!declarations.empty() && declarations.back().scopeLevel == currentScopeLevel) {
+        return false;
     }
-    symbols.push_back({ name, type, currentScopeLevel });
+    declarations.push_back({ name, type, currentScopeLevel });
+    scopes.back().push_back(name);
     return true;
 }
 
 bool SymbolTable::isDeclared(const std::string& name) const {
-    for (auto it = symbols.rbegin(); it != symbols.rend(); ++it) {
-        if (it->name == name) return true;
-    }
-    return false;
+    return lookup(name) != nullptr;
 }
 
-std::string SymbolTable::getType(const std::string& name) const {
-    for (auto it = symbols.rbegin(); it != symbols.rend(); ++it) {
-        if (it->name == name) return it->type;
-    }
-    return "";
+TypeId SymbolTable::getType(const std::string& name) const {
+    const Symbol* symbol = lookup(name);
+    return symbol ? symbol->type : Types::Unknown;
+}
+
+const Symbol* SymbolTable::lookup(const std::string& name) const {
+    auto it = symbols.find(name);
+    return it == symbols.end() ? nullptr : &it->second.back();
+}
+
+bool SymbolTable::declareFunction(const std::string& name, const FunctionSignature& signature) {
+    return functions.emplace(name, signature).second;
+}
+
+const FunctionSignature* SymbolTable::findFunction(const std::string& name) const {
+    auto it = functions.find(name);
+    return it == functions.end() ? nullptr : &it->second;
+}
+
+FunctionSignature* SymbolTable::findFunction(const std::string& name) {
+    auto it = functions.find(name);
+    return it == functions.end() ? nullptr : &it->second;
 }
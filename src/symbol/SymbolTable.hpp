@@ -1,26 +1,45 @@
 #ifndef SYMBOL_TABLE_HPP
 #define SYMBOL_TABLE_HPP
 
+#include "Types.hpp"
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 
 struct Symbol {
     std::string name;
-    std::string type;
+    TypeId type;
     int scopeLevel;
 };
 
+struct FunctionSignature {
+    TypeId returnType;
+    std::vector<TypeId> parameters;
+    bool predeclared; // seen ahead of time, its definition not reached yet
+};
+
 class SymbolTable {
 public:
     void enterScope();
     void exitScope();
-    bool declare(const std::string& name, const std::string& type);
+    bool declare(const std::string& name, TypeId type);
     bool isDeclared(const std::string& name) const;
-    std::string getType(const std::string& name) const;
+    TypeId getType(const std::string& name) const;
+    const Symbol* lookup(const std::string& name) const;
+    int scopeLevel() const { return currentScopeLevel; }
+
+    // Functions live in a single global namespace.
+    bool declareFunction(const std::string& name, const FunctionSignature& signature);
+    const FunctionSignature* findFunction(const std::string& name) const;
+    FunctionSignature* findFunction(const std::string& name);
 
 private:
-    std::vector<Symbol> symbols;
+    // Declarations in scope by name, innermost last.
+    std::unordered_map<std::string, std::vector<Symbol>> symbols;
+    // Names declared in each open scope, so exitScope only touches those.
+    std::vector<std::vector<std::string>> scopes { {} };
+    std::unordered_map<std::string, FunctionSignature> functions;
     int currentScopeLevel = 0;
 };
 
@@ -0,0 +1,42 @@
+#include "Types.hpp"
+
+TypeTable::TypeTable() {
+    for (const char* builtin : { "<unknown>", "<error>", "void", "bool", "char", "int", "float", "string" }) {
+        intern(builtin);
+    }
+}
+
+TypeId TypeTable::intern(const std::string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+
+    TypeId id = static_cast<TypeId>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+TypeId TypeTable::lookup(const std::string& name) const {
+    auto it = ids.find(name);
+    if (it == ids.end() || it->second < Types::Void) return Types::Error;
+    return it->second;
+}
+
+const std::string& TypeTable::name(TypeId id) const {
+    return names[id < names.size() ? id : Types::Unknown];
+}
+
+size_t TypeTable::sizeOf(TypeId id) const {
+    switch (id) {
+    case Types::Void: return 0;
+    case Types::Bool:
+    case Types::Char: return 1;
+    case Types::Float: return 4;
+    default: return 2;
+    }
+}
+
+size_t TypeTable::alignOf(TypeId id) const {
+    size_t size = sizeOf(id);
+    return size == 0 ? 1 : size;
+}
@@ -0,0 +1,48 @@
+#ifndef TYPES_HPP
+#define TYPES_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using TypeId = std::uint16_t;
+
+// Builtin types are interned at these fixed ids by every TypeTable.
+namespace Types {
+    constexpr TypeId Unknown = 0; // not checked yet
+    constexpr TypeId Error = 1;   // already reported; suppresses follow-up errors
+    constexpr TypeId Void = 2;
+    constexpr TypeId Bool = 3;
+    constexpr TypeId Char = 4;
+    constexpr TypeId Int = 5;
+    constexpr TypeId Float = 6;
+    constexpr TypeId String = 7;
+}
+
+class TypeTable {
+public:
+    TypeTable();
+
+    TypeId intern(const std::string& name);
+    // Id of a known type name, or Types::Error.
+    TypeId lookup(const std::string& name) const;
+    const std::string& name(TypeId id) const;
+
+    // Storage on the 16-bit target: bool/char in a byte, int in a word,
+    // float in a doubleword, string as a near pointer.
+    size_t sizeOf(TypeId id) const;
+    size_t alignOf(TypeId id) const;
+
+    static bool isNumeric(TypeId id) { return id == Types::Int || id == Types::Float; }
+    // Whether a value of type `from` may be stored into `to` (int widens to float).
+    static bool isAssignable(TypeId to, TypeId from) {
+        return to == from || (to == Types::Float && from == Types::Int);
+    }
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, TypeId> ids;
+};
+
+#endif
@@ -0,0 +1,352 @@
+.DATA
+a DW 0
+.CODE
+MOV a, 1
+.DATA
+b DW 0
+.CODE
+MOV AX, c
+PUSH AX
+MOV AX, 1
+MOV BX, AX
+POP AX
+ADD AX, BX
+MOV b, AX
+.DATA
+i DW 0
+.CODE
+MOV i, 0
+L0:
+MOV AX, i
+PUSH AX
+MOV AX, 1
+MOV BX, AX
+POP AX
+ADD AX, BX
+CMP AX, 0
+JE L1
+MOV AX, a
+PUSH AX
+MOV AX, i
+MOV BX, AX
+POP AX
+ADD AX, BX
+MOV a, AX
+MOV AX, i
+PUSH AX
+MOV AX, 1
+MOV BX, AX
+POP AX
+ADD AX, BX
+MOV i, AX
+JMP L0
+L1:
+.DATA
+s DW 0
+.CONST
+S0 DB "texto", 0
+.CODE
+MOV s, OFFSET S0
+.CODE
+MOV AX, s
+CALL __rt_keep_string
+MOV a, AX
+.CONST
+S1 DB 13, 10, 0
+.CODE
+MOV AX, a
+CALL __rt_write_int
+MOV SI, OFFSET S1
+MOV CX, 2
+CALL __rt_write
+.CODE
+CALL __rt_flush
+MOV AX, 4C00h
+INT 21h
+
+.DATA
+__RT_OUT_SIZE EQU 512
+__RT_IN_SIZE EQU 128
+__RT_HEAP_SIZE EQU 4096
+__rt_out DB __RT_OUT_SIZE DUP(?)
+__rt_in DB __RT_IN_SIZE DUP(?)
+__rt_heap DB __RT_HEAP_SIZE DUP(?)
+ALIGN 2
+__rt_out_len DW 0
+__rt_in_len DW 0
+__rt_in_pos DW 0
+__rt_heap_top DW OFFSET __rt_heap
+__rt_string_start DW 0
+__rt_last_string DW 0
+__rt_prev_string DW 0
+__rt_fpu_cw DW 0
+__rt_int_part DW 0
+__rt_frac_part DW 0
+__rt_hundred DW 100
+__rt_building DB 0
+__rt_char DB 0
+__rt_digits DB 6 DUP(?)
+__rt_no_memory_text DB "Erro: memória de strings esgotada", 13, 10
+__RT_NO_MEMORY_LEN EQU $ - __rt_no_memory_text
+
+.CODE
+__rt_write:
+PUSH DS
+POP ES
+CMP __rt_building, 0
+JNE __rt_append
+__rt_write_chunk:
+JCXZ __rt_write_done
+MOV AX, __RT_OUT_SIZE
+SUB AX, __rt_out_len
+JNZ __rt_write_room
+CALL __rt_flush
+MOV AX, __RT_OUT_SIZE
+__rt_write_room:
+CMP AX, CX
+JBE __rt_write_copy
+MOV AX, CX
+__rt_write_copy:
+SUB CX, AX
+PUSH CX
+MOV CX, AX
+MOV DI, OFFSET __rt_out
+ADD DI, __rt_out_len
+ADD __rt_out_len, AX
+REP MOVSB
+POP CX
+JMP __rt_write_chunk
+__rt_write_done:
+RET
+; __rt_begin_string made room for the whole string
+__rt_append:
+MOV DI, __rt_heap_top
+REP MOVSB
+MOV __rt_heap_top, DI
+RET
+__rt_write_str:
+CALL __rt_strlen
+JMP __rt_write
+__rt_strlen:
+PUSH DS
+POP ES
+MOV DI, SI
+XOR AL, AL
+MOV CX, 0FFFFh
+REPNE SCASB
+NOT CX
+DEC CX
+RET
+__rt_write_char:
+MOV __rt_char, AL
+MOV SI, OFFSET __rt_char
+MOV CX, 1
+JMP __rt_write
+__rt_write_int:
+MOV DI, OFFSET __rt_digits + 6
+MOV BX, 10
+XOR CX, CX
+MOV SI, AX
+TEST AX, AX
+JNS __rt_int_digit
+NEG AX
+__rt_int_digit:
+XOR DX, DX
+DIV BX
+ADD DL, '0'
+DEC DI
+MOV [DI], DL
+INC CX
+TEST AX, AX
+JNZ __rt_int_digit
+TEST SI, SI
+JNS __rt_int_write
+DEC DI
+MOV BYTE PTR [DI], '-'
+INC CX
+__rt_int_write:
+MOV SI, DI
+JMP __rt_write
+__rt_write_float:
+FTST
+FSTSW AX
+SAHF
+JAE __rt_float_positive
+FABS
+MOV AL, '-'
+CALL __rt_write_char
+__rt_float_positive:
+FSTCW __rt_fpu_cw
+PUSH __rt_fpu_cw
+OR __rt_fpu_cw, 0C00h
+FLDCW __rt_fpu_cw
+FLD ST(0)
+FRNDINT
+FIST __rt_int_part
+FSUBP ST(1), ST(0)
+FIMUL __rt_hundred
+FISTP __rt_frac_part
+POP __rt_fpu_cw
+FLDCW __rt_fpu_cw
+MOV AX, __rt_int_part
+CALL __rt_write_int
+MOV AL, '.'
+CALL __rt_write_char
+MOV AX, __rt_frac_part
+XOR DX, DX
+MOV BX, 10
+DIV BX
+ADD AL, '0'
+MOV __rt_digits, AL
+ADD DL, '0'
+MOV __rt_digits + 1, DL
+MOV SI, OFFSET __rt_digits
+MOV CX, 2
+JMP __rt_write
+; keeps one byte of the heap for the terminator
+__rt_begin_string:
+MOV AX, OFFSET __rt_heap + __RT_HEAP_SIZE - 1
+SUB AX, __rt_heap_top
+CMP CX, AX
+JA __rt_no_memory
+MOV AX, __rt_heap_top
+MOV __rt_string_start, AX
+MOV __rt_building, 1
+RET
+__rt_no_memory:
+MOV __rt_building, 0
+CALL __rt_flush
+MOV AH, 40h
+MOV BX, 2
+MOV CX, __RT_NO_MEMORY_LEN
+MOV DX, OFFSET __rt_no_memory_text
+INT 21h
+MOV AX, 4C01h
+INT 21h
+__rt_end_string:
+MOV DI, __rt_heap_top
+MOV BYTE PTR [DI], 0
+INC DI
+MOV __rt_heap_top, DI
+MOV __rt_building, 0
+MOV AX, __rt_last_string
+MOV __rt_prev_string, AX
+MOV AX, __rt_string_start
+MOV __rt_last_string, AX
+RET
+__rt_keep_string:
+CMP AX, __rt_last_string
+JNE __rt_keep_done
+MOV __rt_last_string, 0
+__rt_keep_done:
+RET
+; the new string is moved down onto the old one, which lies right below it
+__rt_reuse_string:
+CMP AX, __rt_last_string
+JNE __rt_reuse_done
+TEST BX, BX
+JZ __rt_reuse_done
+CMP BX, __rt_prev_string
+JNE __rt_reuse_done
+PUSH DS
+POP ES
+MOV SI, AX
+MOV DI, BX
+MOV CX, __rt_heap_top
+SUB CX, AX
+REP MOVSB
+MOV __rt_heap_top, DI
+MOV __rt_last_string, BX
+MOV __rt_prev_string, 0
+MOV AX, BX
+__rt_reuse_done:
+RET
+__rt_flush:
+PUSH AX
+PUSH BX
+PUSH CX
+PUSH DX
+MOV CX, __rt_out_len
+JCXZ __rt_flush_done
+MOV AH, 40h
+MOV BX, 1
+MOV DX, OFFSET __rt_out
+INT 21h
+MOV __rt_out_len, 0
+__rt_flush_done:
+POP DX
+POP CX
+POP BX
+POP AX
+RET
+; next input byte in AL, CF set at end of input
+__rt_read_byte:
+MOV SI, __rt_in_pos
+CMP SI, __rt_in_len
+JB __rt_read_byte_ready
+PUSH BX
+PUSH CX
+PUSH DX
+MOV AH, 3Fh
+XOR BX, BX
+MOV CX, __RT_IN_SIZE
+MOV DX, OFFSET __rt_in
+INT 21h
+POP DX
+POP CX
+POP BX
+JNC __rt_read_byte_filled
+XOR AX, AX
+__rt_read_byte_filled:
+MOV __rt_in_len, AX
+XOR SI, SI
+MOV __rt_in_pos, SI
+TEST AX, AX
+JNZ __rt_read_byte_ready
+STC
+RET
+__rt_read_byte_ready:
+MOV AL, __rt_in[SI]
+INC SI
+MOV __rt_in_pos, SI
+CLC
+RET
+; skips anything before the number, so a prompt's newline is harmless
+__rt_read_int:
+CALL __rt_flush
+XOR BX, BX
+XOR CX, CX
+__rt_read_skip:
+CALL __rt_read_byte
+JC __rt_read_done
+CMP AL, '-'
+JE __rt_read_minus
+CMP AL, '0'
+JB __rt_read_skip
+CMP AL, '9'
+JA __rt_read_skip
+JMP __rt_read_digit
+__rt_read_minus:
+MOV CL, 1
+JMP __rt_read_next
+__rt_read_digit:
+SUB AL, '0'
+XOR AH, AH
+XCHG AX, BX
+MOV DX, 10
+MUL DX
+ADD BX, AX
+__rt_read_next:
+CALL __rt_read_byte
+JC __rt_read_done
+CMP AL, '0'
+JB __rt_read_done
+CMP AL, '9'
+JBE __rt_read_digit
+__rt_read_done:
+MOV AX, BX
+TEST CL, CL
+JZ __rt_read_end
+NEG AX
+__rt_read_end:
+RET
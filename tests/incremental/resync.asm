@@ -0,0 +1,31 @@
+.CODE
+JMP L0
+f:
+; frame: 0 bytes for 0 locals in 0 slots, 2 bytes of parameters
+PUSH BP
+MOV BP, SP
+MOV AX, WORD PTR [BP+4]
+MOV SP, BP
+POP BP
+RET
+L0:
+.DATA
+y DW 0
+.CODE
+MOV y, 2
+.CODE
+MOV AX, 1
+PUSH AX
+CALL f
+ADD SP, 2
+.DATA
+z DW 0
+.CODE
+MOV AX, y
+PUSH AX
+CALL f
+ADD SP, 2
+MOV z, AX
+.CODE
+MOV AX, 4C00h
+INT 21h
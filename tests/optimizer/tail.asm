@@ -0,0 +1,170 @@
+.CODE
+JMP L0
+conta:
+; frame: 4 bytes for 2 locals in 2 slots, 4 bytes of parameters
+PUSH BP
+MOV BP, SP
+SUB SP, 4
+L1:
+L3:
+MOV AX, WORD PTR [BP+6]
+PUSH AX
+MOV AX, 0
+MOV BX, AX
+POP AX
+CMP AX, BX
+MOV AX, 1
+JE L5
+XOR AX, AX
+L5:
+CMP AX, 0
+JE L4
+MOV AX, WORD PTR [BP+4]
+MOV SP, BP
+POP BP
+RET
+JMP L3
+L4:
+MOV AX, WORD PTR [BP+6]
+PUSH AX
+MOV AX, 1
+MOV BX, AX
+POP AX
+SUB AX, BX
+MOV WORD PTR [BP-2], AX
+MOV AX, WORD PTR [BP+4]
+PUSH AX
+MOV AX, WORD PTR [BP+6]
+MOV BX, AX
+POP AX
+ADD AX, BX
+MOV WORD PTR [BP-4], AX
+MOV AX, WORD PTR [BP-2]
+MOV WORD PTR [BP+6], AX
+MOV AX, WORD PTR [BP-4]
+MOV WORD PTR [BP+4], AX
+JMP L1
+L2:
+MOV SP, BP
+POP BP
+RET
+L0:
+.CODE
+JMP L6
+mesmo:
+; frame: 2 bytes for 1 locals in 1 slots, 4 bytes of parameters
+PUSH BP
+MOV BP, SP
+SUB SP, 2
+L7:
+L9:
+MOV AX, WORD PTR [BP+4]
+PUSH AX
+MOV AX, 0
+MOV BX, AX
+POP AX
+CMP AX, BX
+MOV AX, 1
+JE L11
+XOR AX, AX
+L11:
+CMP AX, 0
+JE L10
+MOV AX, WORD PTR [BP+6]
+MOV SP, BP
+POP BP
+RET
+JMP L9
+L10:
+MOV AX, WORD PTR [BP+4]
+PUSH AX
+MOV AX, 1
+MOV BX, AX
+POP AX
+SUB AX, BX
+MOV WORD PTR [BP-2], AX
+MOV AX, WORD PTR [BP-2]
+MOV WORD PTR [BP+4], AX
+JMP L7
+L8:
+MOV SP, BP
+POP BP
+RET
+L6:
+.CODE
+JMP L12
+dobra:
+; frame: 2 bytes for 2 locals in 1 slots, 2 bytes of parameters
+PUSH BP
+MOV BP, SP
+SUB SP, 2
+L13:
+MOV AX, WORD PTR [BP+4]
+PUSH AX
+MOV AX, 2
+MOV BX, AX
+POP AX
+IMUL BX
+MOV WORD PTR [BP-2], AX
+L15:
+MOV AX, WORD PTR [BP-2]
+PUSH AX
+MOV AX, 1000
+MOV BX, AX
+POP AX
+CMP AX, BX
+MOV AX, 1
+JG L17
+XOR AX, AX
+L17:
+CMP AX, 0
+JE L16
+MOV AX, WORD PTR [BP-2]
+MOV SP, BP
+POP BP
+RET
+JMP L15
+L16:
+MOV AX, WORD PTR [BP-2]
+MOV WORD PTR [BP+4], AX
+JMP L13
+L14:
+MOV SP, BP
+POP BP
+RET
+L12:
+.DATA
+x DW 0
+.CODE
+MOV x, 1
+.DATA
+c DW 0
+.CODE
+MOV AX, x
+PUSH AX
+MOV AX, 0
+PUSH AX
+CALL conta
+ADD SP, 4
+MOV c, AX
+.DATA
+d DW 0
+.CODE
+MOV AX, c
+PUSH AX
+MOV AX, x
+PUSH AX
+CALL mesmo
+ADD SP, 4
+MOV d, AX
+.DATA
+e DW 0
+.CODE
+MOV AX, d
+PUSH AX
+CALL dobra
+ADD SP, 2
+MOV e, AX
+.CODE
+MOV AX, 4C00h
+INT 21h
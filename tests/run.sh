@@ -0,0 +1,89 @@
+#!/bin/sh
+# Regression tests for the C++ compiler in src/. Usage: tests/run.sh
+#
+# Every tests/<area>/<name>.txt is compiled and the output compared with
+# <name>.asm (standard output) and <name>.err (standard error); a missing
+# file stands for no output. It is compiled a second time from standard
+# input, which must give the same result. A first line `// args: <flags>` is
+# passed to the compiler. With UPDATE=1 the expected files are rewritten
+# instead.
+set -u
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+compiler="$work/compilador"
+g++ -std=c++17 -O2 -o "$compiler" "$root"/src/main.cpp "$root"/src/lexer/*.cpp "$root"/src/parser/*.cpp \
+    "$root"/src/semantic/*.cpp "$root"/src/codegen/*.cpp "$root"/src/symbol/*.cpp "$root"/src/optimizer/*.cpp || exit 1
+
+failures=0
+fail() {
+    echo "FALHOU: $1"
+    failures=$((failures + 1))
+}
+
+# Compares $work/<stream> with the expected file, or replaces it.
+expect() {
+    if [ "${UPDATE:-0}" = 1 ]; then
+        if [ -s "$work/$1" ]; then cp "$work/$1" "$2"; else rm -f "$2"; fi
+    elif [ -f "$2" ]; then
+        diff -u "$2" "$work/$1" >"$work/diff" || { fail "$3"; cat "$work/diff"; }
+    elif [ -s "$work/$1" ]; then
+        fail "$3"
+        cat "$work/$1"
+    fi
+}
+
+for source in "$root"/tests/*/*.txt; do
+    name=${source%.txt}
+    case=${name#"$root"/tests/}
+    flags=$(sed -n '1s|^// args: *||p' "$source")
+    # shellcheck disable=SC2086
+    (cd "$work" && "$compiler" $flags "$source" >out 2>err)
+    expect out "$name.asm" "$case (saída)"
+    expect err "$name.err" "$case (erros)"
+    # shellcheck disable=SC2086
+    "$compiler" $flags - <"$source" >"$work/out" 2>"$work/err"
+    expect out "$name.asm" "$case (saída, entrada padrão)"
+    expect err "$name.err" "$case (erros, entrada padrão)"
+done
+
+# The source is read in 64 KiB windows. A comment moves a statement across
+# the end of the first window one character at a time, so the cut falls
+# inside each of its tokens in turn; the code must not change.
+statement='var numero: int = 12345; var b: bool = numero <= 99999; var s: string = "texto" + numero; print(s); // fim'
+printf '%s\n' "$statement" >"$work/plain.txt"
+"$compiler" "$work/plain.txt" >"$work/plain.asm" 2>&1
+cut=0
+while [ "$cut" -le ${#statement} ]; do
+    # "//", the padding and "\n" come before the statement.
+    { printf '//'; head -c $((65536 - 3 - cut)) /dev/zero | tr '\0' x; printf '\n%s\n' "$statement"; } >"$work/padded.txt"
+    "$compiler" "$work/padded.txt" >"$work/out" 2>&1
+    cmp -s "$work/plain.asm" "$work/out" || fail "janela de leitura cortando o caractere $cut (arquivo)"
+    "$compiler" - <"$work/padded.txt" >"$work/out" 2>&1
+    cmp -s "$work/plain.asm" "$work/out" || fail "janela de leitura cortando o caractere $cut (entrada padrão)"
+    cut=$((cut + 1))
+done
+
+# Nothing in these programs can be optimized, so -O, which checks each
+# statement before generating it in a pass of its own, must generate what
+# the fused traversal does.
+for source in "$root"/tests/fused/*.txt; do
+    "$compiler" -O "$source" >"$work/out" 2>/dev/null
+    cmp -s "${source%.txt}.asm" "$work/out" || fail "passes separadas ${source#"$root"/}"
+done
+
+# Deep nesting must not overflow a small stack in any phase.
+(ulimit -s 512 && "$compiler" --stress-depth 200000) >"$work/out" 2>&1 || { fail "--stress-depth 200000"; cat "$work/out"; }
+
+# Every edit of every position is checked against a full parse.
+for source in "$root"/tests/incremental/*.txt; do
+    "$compiler" --incremental-check "$source" >"$work/out" 2>&1 || { fail "--incremental-check ${source#"$root"/}"; cat "$work/out"; }
+done
+
+if [ "$failures" -gt 0 ]; then
+    echo "$failures teste(s) falharam."
+    exit 1
+fi
+echo "Testes: OK"
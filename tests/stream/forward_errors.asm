@@ -0,0 +1,95 @@
+.DATA
+F0 DD 2.0
+a DW 0
+.CODE
+FLD F0
+SUB SP, 4
+MOV BX, SP
+FSTP DWORD PTR [BX]
+CALL metade
+ADD SP, 4
+MOV a, AX
+.DATA
+ALIGN 4
+g DD 0.0
+.CODE
+MOV AX, 1
+PUSH AX
+CALL dobro
+ADD SP, 2
+FSTP g
+.DATA
+h DW 0
+.CODE
+MOV AX, 1
+PUSH AX
+MOV AX, 2
+PUSH AX
+CALL conta
+ADD SP, 4
+MOV h, AX
+.CODE
+MOV AX, 1
+PUSH AX
+CALL falta
+ADD SP, 2
+.CODE
+CALL descarta
+.CODE
+JMP L0
+dobro:
+; frame: 0 bytes for 0 locals in 0 slots, 2 bytes of parameters
+PUSH BP
+MOV BP, SP
+MOV AX, WORD PTR [BP+4]
+PUSH AX
+MOV AX, 2
+MOV BX, AX
+POP AX
+IMUL BX
+MOV SP, BP
+POP BP
+RET
+L0:
+.DATA
+ALIGN 4
+F1 DD 2.0
+.CODE
+JMP L1
+metade:
+; frame: 0 bytes for 0 locals in 0 slots, 4 bytes of parameters
+PUSH BP
+MOV BP, SP
+FLD DWORD PTR [BP+4]
+FDIV F1
+MOV SP, BP
+POP BP
+RET
+L1:
+.CODE
+JMP L2
+conta:
+; frame: 0 bytes for 0 locals in 0 slots, 6 bytes of parameters
+PUSH BP
+MOV BP, SP
+MOV AX, WORD PTR [BP+4]
+MOV SP, BP
+POP BP
+RET
+L2:
+.DATA
+F2 DD 1.5
+.CODE
+JMP L3
+descarta:
+; frame: 0 bytes for 0 locals in 0 slots, 0 bytes of parameters
+PUSH BP
+MOV BP, SP
+FLD F2
+MOV SP, BP
+POP BP
+RET
+L3:
+.CODE
+MOV AX, 4C00h
+INT 21h